@@ -0,0 +1,108 @@
+/*
+  Date: 10/2019
+  Author: Serhii Marchuk <marchserh@gmail.com>
+  
+  This example shows how to use ModbusPoller with ModbusMasterRTU. 
+  It polls remote Modbus slave via serial port,
+  in this case used Serial1 (for Arduino MEGA). 
+  Change this port (or not) to communicate with your Modbus device or simulator.
+  
+  Poller reads list of items periodically instead of hand written state machine in loop:
+  1. holding registers [400001..400010] and [400011..400020] - every 500 ms (merged into one frame)
+  2. holding registers [400023..400026]                       - every 500 ms (merged too: gap is 2 registers)
+  3. input registers   [300001..300004]                       - every 1000 ms
+  4. coils             [000001..000016]                       - every 200 ms
+
+*/
+
+
+#include <ModbusMasterRTU.h>
+#include <ModbusPoller.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------ INITIALIZE MODBUS RTU MASTER --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusMasterRTU mb(&Serial1); // serial port to read/write
+
+
+// --------------------------------------------------------------------------------------------------------
+// ----------------------------------------- INITIALIZE POLLER --------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+uint16_t reges1[10];
+uint16_t reges2[10];
+uint16_t reges3[4];
+uint16_t inputs[4];
+uint8_t coils[2];
+
+ModbusPollItem items[] = {
+//   slave, function                  , offset, count, period, data
+    {1    , MBF_READ_HOLDING_REGISTERS, 0     , 10   , 500   , reges1},
+    {1    , MBF_READ_HOLDING_REGISTERS, 10    , 10   , 500   , reges2},
+    {1    , MBF_READ_HOLDING_REGISTERS, 22    , 4    , 500   , reges3},
+    {1    , MBF_READ_INPUT_REGISTERS  , 0     , 4    , 1000  , inputs},
+    {1    , MBF_READ_COIL_STATUS      , 0     , 16   , 200   , coils }
+};
+
+#define ITEMS_SZ (sizeof(items)/sizeof(items[0]))
+
+ModbusPoller poller(&mb, items, ITEMS_SZ);
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ SETUP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void setup()
+{
+   // Open serial communications and wait for port to open:
+    Serial.begin(9600);
+    while (!Serial) // wait for serial port to connect. Needed for native USB port only
+        delay(1);
+    Serial.println("============================================================");
+    Serial.println("=================== MODBUS POLLER EXAMPLE ==================");
+    Serial.println("============================================================");
+    Serial.println("Initialize Serial1 port and set parameters:\n9600 - speed\n8 - data bits\nNo Parity\n1 - stop bit");
+    Serial1.begin(9600, SERIAL_8N1);
+    
+    poller.coalesce();
+    Serial.print("Count of items: ");Serial.print(ITEMS_SZ);Serial.print(", count of frames: ");Serial.println(poller.frameCount());
+    Serial.println();
+}
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- LOOP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+unsigned long last = 0;
+
+void loop()
+{
+    poller.exec();
+    // print values once per second
+    if (millis()-last >= 1000)
+    {
+        last = millis();
+        Serial.print("Cycle time: ");Serial.print(poller.cycleTime());Serial.println(" ms");
+        for (unsigned int i = 0; i < ITEMS_SZ; i++)
+        {
+            Serial.print("Item ");Serial.print(i);Serial.print(": ");
+            if (items[i].status == Modbus::OK)
+            {
+                Serial.print("first value ");
+                if (items[i].func == MBF_READ_COIL_STATUS)
+                    Serial.println(Modbus::getBit(items[i].data, 0));
+                else
+                    Serial.println(reinterpret_cast<uint16_t*>(items[i].data)[0]);
+            }
+            else
+            {
+                Serial.print("status ");
+                Serial.println(items[i].status);
+            }
+        }
+        Serial.println();
+    }
+}
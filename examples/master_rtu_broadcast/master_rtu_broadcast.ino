@@ -0,0 +1,129 @@
+/*
+  Date: 10/2019
+  Author: Serhii Marchuk <marchserh@gmail.com>
+
+  This example shows how to use broadcast writes of ModbusMasterRTU (slave address 0).
+  It makes requests to remote Modbus slaves via serial port,
+  in this case used Serial1 (for Arduino MEGA).
+  Change this port (or not) to communicate with your Modbus devices or simulator.
+
+  Nobody responds to broadcast, so write function returns Modbus::OK as soon as request is sent
+  and turnaround delay is elapsed (not after 'timeoutFirstByte'). Then the bus is free for next request.
+
+  Every cycle:
+  16. FORCE MULTIPLE REGISTERS  - to slave 0 (broadcast): write 2 registers 400001 and 400002
+                                  with time counter (seconds since start) to all slaves of the line
+  3.  READ HOLDING REGISTERS    - from slave 1: read the same 2 registers right after broadcast
+
+  This program was tested on Arduino MEGA platform
+
+*/
+
+
+#include <ModbusMasterRTU.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------ INITIALIZE MODBUS RTU MASTER --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusMasterRTU mb(&Serial1); // serial port to read/write
+
+// time that slaves need to process broadcast request before next request
+#define TURNAROUND_DELAY 100 // milliseconds
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ SETUP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+void setup()
+{
+   // Open serial communications and wait for port to open:
+    Serial.begin(9600);
+    while (!Serial) // wait for serial port to connect. Needed for native USB port only
+        delay(1);
+    Serial.println("============================================================");
+    Serial.println("=============== MODBUS RTU BROADCAST EXAMPLE ===============");
+    Serial.println("============================================================");
+    Serial.println("Initialize Serial1 port and set parameters:\n9600 - speed\n8 - data bits\nNo Parity\n1 - stop bit");
+    Serial1.begin(9600, SERIAL_8N1);
+    mb.setTurnaroundDelay(TURNAROUND_DELAY);
+    // VERBOSE MODE
+    mb.setVerboseStream(&Serial);
+
+    Serial.println();
+}
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- LOOP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+int func_idx = 0;
+unsigned long start;
+uint16_t reges[2];
+
+void loop()
+{
+    uint8_t slave;
+    uint16_t buff[2];
+    unsigned long tm;
+    uint16_t fact;
+    Modbus::Response r;
+    switch (func_idx)
+    {
+    // ------------------------------------------------
+    // prepare values to write
+    case 0:
+        start = millis();
+        tm = start / 1000;
+        reges[0] = static_cast<uint16_t>(tm >> 16);
+        reges[1] = static_cast<uint16_t>(tm);
+        func_idx = MBF_FORCE_MULTIPLE_REGISTERS; // change function processing
+        // no need break
+    // ------------------------------------------------
+    // 16. FORCE MULTIPLE REGISTERS (broadcast)
+    case MBF_FORCE_MULTIPLE_REGISTERS:
+        slave = Modbus::BROADCAST_ADDRESS;
+        r = mb.forceMultipleRegisters(slave, 0, 2, reges, &fact);
+        if (r == Modbus::OK)
+        {
+            Serial.print("BROADCAST FORCE MULTIPLE REGISTERS success. Bus is free after ");Serial.print(millis()-start);Serial.println(" ms");
+        }
+        else if (r > Modbus::OK)
+        {
+            Serial.print("Error while BROADCAST FORCE MULTIPLE REGISTERS. Code: ");
+            Serial.println(r);
+            func_idx = 0;
+            delay(1000);
+            break;
+        }
+        else // r < 0 => Modbus::PROCESSING
+            break;
+        func_idx = MBF_READ_HOLDING_REGISTERS; // change function processing
+        // no need break
+    // ------------------------------------------------
+    // 3. READ HOLDING REGISTERS
+    case MBF_READ_HOLDING_REGISTERS:
+        slave = Modbus::VALID_MODBUS_ADDRESS_BEGIN; // Modbus slave address =1
+        r = mb.readHoldingRegisters(slave, 0, 2, buff, &fact);
+        if (r == Modbus::OK)
+        {
+            Serial.print("READ HOLDING REGISTERS success. Time counter of slave 1: ");
+            Serial.println((static_cast<unsigned long>(buff[0]) << 16) | buff[1]);
+        }
+        else if (r > Modbus::OK)
+        {
+            Serial.print("Error while READ HOLDING REGISTERS. Code: ");
+            Serial.println(r);
+        }
+        else // r < 0 => Modbus::PROCESSING
+            break;
+        Serial.println();
+        func_idx = 0; // change function processing
+        delay(5000);
+        break;
+    }
+    // ------------------------------------------------
+    delay(1);
+}
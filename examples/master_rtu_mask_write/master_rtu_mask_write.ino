@@ -0,0 +1,118 @@
+/*
+  Date: 10/2019
+  Author: Serhii Marchuk <marchserh@gmail.com>
+
+  This example shows how to use MASK WRITE REGISTER (FC22) of ModbusMasterRTU
+  to change separate bits of holding register of remote Modbus slave via serial port,
+  in this case used Serial1 (for Arduino MEGA).
+  Change this port (or not) to communicate with your Modbus device or simulator.
+
+  Mask write changes bits by one request instead of read-modify-write
+  (READ HOLDING REGISTERS + FORCE SINGLE REGISTER) and it doesn't overwrite
+  bits that slave itself changed between read and write:
+  result = (current & andMask) | (orMask & ~andMask)
+
+  Every cycle:
+  22. MASK WRITE REGISTER       - to toggle bit (cycle % 16) of register 400001
+  3.  READ HOLDING REGISTERS    - to read register 400001 and show its new value
+
+  This program was tested on Arduino MEGA platform
+
+*/
+
+
+#include <ModbusMasterRTU.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------ INITIALIZE MODBUS RTU MASTER --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusMasterRTU mb(&Serial1); // serial port to read/write
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ SETUP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+uint8_t slave = Modbus::VALID_MODBUS_ADDRESS_BEGIN; // Modbus slave address =1
+
+void setup()
+{
+   // Open serial communications and wait for port to open:
+    Serial.begin(9600);
+    while (!Serial) // wait for serial port to connect. Needed for native USB port only
+        delay(1);
+    Serial.println("============================================================");
+    Serial.println("============= MODBUS MASK WRITE REGISTER EXAMPLE ===========");
+    Serial.println("============================================================");
+    Serial.println("Initialize Serial1 port and set parameters:\n9600 - speed\n8 - data bits\nNo Parity\n1 - stop bit");
+    Serial1.begin(9600, SERIAL_8N1);
+    // VERBOSE MODE
+    mb.setVerboseStream(&Serial);
+
+    Serial.println();
+}
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- LOOP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+int func_idx = MBF_MASK_WRITE_4X_REGISTER;
+uint16_t cycle = 0;
+bool bitValue = true;
+
+void loop()
+{
+    uint16_t bit = static_cast<uint16_t>(1 << (cycle % 16));
+    uint16_t value, fact;
+    Modbus::Response r;
+    switch (func_idx)
+    {
+    // ------------------------------------------------
+    // 22. MASK WRITE REGISTER
+    case MBF_MASK_WRITE_4X_REGISTER:
+        // AND mask keeps all bits except 'bit', OR mask sets 'bit' to 'bitValue'
+        r = mb.maskWriteRegister(slave, 0, ~bit, bitValue ? bit : 0);
+        if (r == Modbus::OK)
+        {
+            Serial.print("MASK WRITE REGISTER success. Bit ");Serial.print(cycle % 16);Serial.print(" was set to ");Serial.println(bitValue);
+        }
+        else if (r > Modbus::OK)
+        {
+            Serial.print("Error while MASK WRITE REGISTER. Code: ");
+            Serial.println(r);
+            delay(1000);
+            break;
+        }
+        else // r < 0 => Modbus::PROCESSING
+            break;
+        func_idx = MBF_READ_HOLDING_REGISTERS; // change function processing
+        // no need break
+    // ------------------------------------------------
+    // 3. READ HOLDING REGISTERS
+    case MBF_READ_HOLDING_REGISTERS:
+        r = mb.readHoldingRegisters(slave, 0, 1, &value, &fact);
+        if (r == Modbus::OK)
+        {
+            Serial.print("READ HOLDING REGISTERS success. Register 400001 = 0x");Serial.println(value, HEX);
+        }
+        else if (r > Modbus::OK)
+        {
+            Serial.print("Error while READ HOLDING REGISTERS. Code: ");
+            Serial.println(r);
+        }
+        else // r < 0 => Modbus::PROCESSING
+            break;
+        Serial.println();
+        // next bit; every bit is toggled back after 16 cycles
+        cycle++;
+        if ((cycle % 16) == 0)
+            bitValue = !bitValue;
+        func_idx = MBF_MASK_WRITE_4X_REGISTER; // change function processing
+        delay(1000);
+        break;
+    }
+    // ------------------------------------------------
+    delay(1);
+}
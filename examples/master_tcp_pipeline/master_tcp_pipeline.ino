@@ -0,0 +1,101 @@
+/*
+  Date: 10/2019
+  Author: Serhii Marchuk <marchserh@gmail.com>
+  
+  This example shows how to use ModbusMasterTCPChannel to pipeline requests. 
+  It makes requests to remote Modbus slave via TCP,
+  in this case used ip '192.168.100.105'. 
+  Change this ip (or not) to communicate with your Modbus device or simulator.
+  
+  4 channels share one TCP connection of ModbusMasterTCP and each of them reads
+  its own block of 10 holding registers [400001..400040], so 4 requests are in flight
+  at the same time instead of waiting for each response in turn.
+
+*/
+
+
+#include <Ethernet.h>
+#include <ModbusMasterTCPChannel.h>
+
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------- INITIALIZE ETHERNET SERVER LIBRARY ----------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// MAC address of current device:
+// generated by https://www.miniwebtool.com/mac-address-generator/
+byte mac[] = { 0x62, 0xE0, 0x14, 0x20, 0x11, 0xC2 };
+// IP address of current device:
+IPAddress ip(192, 168, 100, 103);
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------ INITIALIZE MODBUS TCP MASTER --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+#define CHANNELS_SZ 4
+
+ModbusMasterTCP mb("192.168.100.105"); // remote ip address (slave)
+ModbusMasterTCPChannel ch0(&mb), ch1(&mb), ch2(&mb), ch3(&mb); // pipelined channels of connection
+ModbusMasterTCPChannel* channels[CHANNELS_SZ] = { &ch0, &ch1, &ch2, &ch3 };
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ SETUP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+uint8_t slave = Modbus::VALID_MODBUS_ADDRESS_BEGIN; // Modbus slave address =1
+    
+void setup()
+{
+   // Open serial communications and wait for port to open:
+    Serial.begin(9600);
+    while (!Serial) // wait for serial port to connect. Needed for native USB port only
+        delay(1);
+    Serial.println("============================================================");
+    Serial.println("============ MODBUS MASTER TCP PIPELINE EXAMPLE ============");
+    Serial.println("============================================================");
+    Serial.println("Initialize Ethernet library");  
+    Ethernet.begin(mac, ip);
+    Serial.print("Ethernet localIP is at ");Serial.println(Ethernet.localIP());
+    
+    mb.setWindow(CHANNELS_SZ); // maximum count of outstanding requests
+    Serial.println();
+}
+
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- LOOP -------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+#define REGES_SZ 10
+uint16_t reges[CHANNELS_SZ][REGES_SZ];
+
+void loop()
+{
+    uint16_t fact;
+    Modbus::Response r;
+    int c, i;
+    for (c = 0; c < CHANNELS_SZ; c++)
+    {
+        r = channels[c]->readHoldingRegisters(slave, c*REGES_SZ, REGES_SZ, reges[c], &fact);
+        if (r == Modbus::OK)
+        {
+            Serial.print("Channel ");Serial.print(c);Serial.print(": READ HOLDING REGISTERS success. ");Serial.print(fact);Serial.print(" registers was read.\nValues: ");
+            for (i = 0; i < fact; i++)
+            {
+                Serial.print(reges[c][i]);
+                Serial.print(' ');
+            }
+            Serial.println();
+        }
+        else if (r > Modbus::OK)
+        {
+            Serial.print("Channel ");Serial.print(c);Serial.print(": Error while READ HOLDING REGISTERS. Code: ");
+            Serial.println(r);
+        }
+        // else r < 0 => Modbus::PROCESSING
+    }
+    // ------------------------------------------------
+    delay(1);
+}
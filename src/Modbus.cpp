@@ -24,21 +24,361 @@
 #include "Modbus.h"
 
 #include <Stream.h>
+#include <string.h>
 
-uint16_t Modbus::crc16(const uint8_t* data, uint16_t szData)
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- CRC16 (RTU) ----------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define MB_CRC16_TABLE_ATTR PROGMEM
+#define MB_CRC16_TABLE_AT(i) pgm_read_word(&c_crc16Table[i])
+#else
+#define MB_CRC16_TABLE_ATTR
+#define MB_CRC16_TABLE_AT(i) c_crc16Table[i]
+#endif
+
+// Slicing-by-8 CRC16 kernel (8 KiB of RAM tables) is enabled by default for host (gateway) builds only.
+// Define MODBUS_CRC16_SLICING_BY_8 as 0 or 1 to override default choice
+#ifndef MODBUS_CRC16_SLICING_BY_8
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) || defined(__aarch64__)
+#define MODBUS_CRC16_SLICING_BY_8 1
+#else
+#define MODBUS_CRC16_SLICING_BY_8 0
+#endif
+#endif
+
+// CRC16 lookup table for reflected polynom 0xA001 (table[i] = crc of single byte 'i' with zero initial value)
+static const uint16_t c_crc16Table[256] MB_CRC16_TABLE_ATTR =
 {
-    uint16_t i, j, temp, CRC = 0xFFFF;
-    for (i = 0; i < szData; i++)
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+#if MODBUS_CRC16_SLICING_BY_8
+
+// table[k][i] = crc of byte 'i' followed by k zero bytes (with zero initial value)
+struct Crc16SlicingTable
+{
+    uint16_t table[8][256];
+    Crc16SlicingTable()
     {
-        CRC ^= data[i];
-        for (j = 0; j < 8; j++)
+        for (uint16_t i = 0; i < 256; i++)
         {
-            temp = CRC & 0x0001;
-            CRC >>= 1;
-            if (temp) CRC ^= 0xA001;
+            table[0][i] = c_crc16Table[i];
+            for (uint8_t k = 1; k < 8; k++)
+                table[k][i] = (table[k-1][i] >> 8) ^ c_crc16Table[table[k-1][i] & 0xFF];
         }
     }
-    return CRC;
+};
+
+// minimum size of data when slicing kernel is faster than bytewise table
+static const uint16_t c_crc16SlicingMinSz = 16;
+
+static uint16_t crc16_slicing_by_8(uint16_t crc, const uint8_t* data, uint16_t szData)
+{
+    static const Crc16SlicingTable s; // built once on first use
+    const uint16_t (*t)[256] = s.table;
+    for (; szData >= 8; szData -= 8, data += 8)
+    {
+        crc ^= static_cast<uint16_t>(data[0] | (data[1] << 8));
+        crc = t[7][crc & 0xFF] ^ t[6][crc >> 8] ^ t[5][data[2]] ^ t[4][data[3]] ^
+              t[3][data[4]]    ^ t[2][data[5]]  ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; szData; szData--)
+        crc = (crc >> 8) ^ c_crc16Table[static_cast<uint8_t>(crc ^ *data++)];
+    return crc;
+}
+
+#endif // MODBUS_CRC16_SLICING_BY_8
+
+uint16_t Modbus::crc16_update(uint16_t crc, uint8_t byte)
+{
+    return (crc >> 8) ^ MB_CRC16_TABLE_AT(static_cast<uint8_t>(crc ^ byte));
+}
+
+uint16_t Modbus::crc16_update(uint16_t crc, const uint8_t* data, uint16_t szData)
+{
+#if MODBUS_CRC16_SLICING_BY_8
+    if (szData >= c_crc16SlicingMinSz)
+        return crc16_slicing_by_8(crc, data, szData);
+#endif
+    for (; szData; szData--)
+        crc = (crc >> 8) ^ MB_CRC16_TABLE_AT(static_cast<uint8_t>(crc ^ *data++));
+    return crc;
+}
+
+uint16_t Modbus::crc16(const uint8_t* data, uint16_t szData)
+{
+    return crc16_update(MB_CRC16_INIT, data, szData);
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------ BOOL ARRAY <-> BITS -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Whole bytes of bit buffer are expanded to (packed from) 8 bools at once. bool is 1 byte with value 0/1
+// for all supported compilers. x86 host builds use SIMD kernels selected by compiler target flags
+// (-msse2, -mavx2, -mbmi2), other 64-bit cores use multiply tricks, AVR uses unrolled bit tests.
+// 64-bit lane kernels copy the word to/from bool[8] in memory order, so they are used only on little-endian cores.
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__BMI2__) && defined(__x86_64__) // _pdep_u64/_pext_u64 are available only in 64-bit mode
+#define MB_BOOLS_PDEP64 1
+#else
+#define MB_BOOLS_PDEP64 0
+#endif
+
+#if !defined(__AVR__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && \
+    (MB_BOOLS_PDEP64 || (defined(__SIZEOF_POINTER__) && (__SIZEOF_POINTER__ >= 8)))
+#define MB_BOOLS_WORD64 1
+#else
+#define MB_BOOLS_WORD64 0
+#endif
+
+// expand 'byte' into 8 bools
+static inline void expand_byte(uint8_t byte, bool* b)
+{
+#if MB_BOOLS_WORD64
+#if MB_BOOLS_PDEP64
+    uint64_t v = _pdep_u64(byte, 0x0101010101010101ULL);
+#else
+    // spread byte into every byte-lane, isolate i-th bit in i-th lane and shift it to bit0 of the lane
+    uint64_t v = (byte * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    v = ((v + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+#endif
+    memcpy(b, &v, sizeof(v));
+#else
+    b[0] = (byte & 0x01) != 0;
+    b[1] = (byte & 0x02) != 0;
+    b[2] = (byte & 0x04) != 0;
+    b[3] = (byte & 0x08) != 0;
+    b[4] = (byte & 0x10) != 0;
+    b[5] = (byte & 0x20) != 0;
+    b[6] = (byte & 0x40) != 0;
+    b[7] = (byte & 0x80) != 0;
+#endif
+}
+
+// pack 8 bools into byte
+static inline uint8_t pack_byte(const bool* b)
+{
+#if MB_BOOLS_WORD64
+    uint64_t v;
+    memcpy(&v, b, sizeof(v));
+#if MB_BOOLS_PDEP64
+    return static_cast<uint8_t>(_pext_u64(v, 0x0101010101010101ULL));
+#else
+    // i-th lane bit0 moves to bit (56+i) and lands in the most significant byte
+    return static_cast<uint8_t>(((v & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56);
+#endif
+#else
+    uint8_t byte = 0;
+    if (b[0]) byte |= 0x01;
+    if (b[1]) byte |= 0x02;
+    if (b[2]) byte |= 0x04;
+    if (b[3]) byte |= 0x08;
+    if (b[4]) byte |= 0x10;
+    if (b[5]) byte |= 0x20;
+    if (b[6]) byte |= 0x40;
+    if (b[7]) byte |= 0x80;
+    return byte;
+#endif
+}
+
+// expand 'byteCount' whole bytes of bits into bools
+static void expand_bytes(const uint8_t* bytes, uint16_t byteCount, bool* b)
+{
+#if defined(__AVX2__)
+    const __m256i shuf = _mm256_setr_epi8(0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1, 2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3);
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+    const __m256i one  = _mm256_set1_epi8(1);
+    for (; byteCount >= 4; byteCount -= 4, bytes += 4, b += 32)
+    {
+        int32_t w;
+        memcpy(&w, bytes, sizeof(w));
+        __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(w), shuf);
+        v = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v, mask), mask), one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b), v);
+    }
+#elif defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+    const __m128i one  = _mm_set1_epi8(1);
+    for (; byteCount >= 2; byteCount -= 2, bytes += 2, b += 16)
+    {
+        __m128i v = _mm_cvtsi32_si128(bytes[0] | (bytes[1] << 8));
+        v = _mm_unpacklo_epi8(v, v);  // b0 b0 b1 b1
+        v = _mm_unpacklo_epi16(v, v); // b0 x4, b1 x4
+        v = _mm_unpacklo_epi32(v, v); // b0 x8, b1 x8
+        v = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, mask), mask), one);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b), v);
+    }
+#endif
+    for (; byteCount; byteCount--, b += 8)
+        expand_byte(*bytes++, b);
+}
+
+// pack bools into 'byteCount' whole bytes of bits
+static void pack_bytes(const bool* b, uint16_t byteCount, uint8_t* bytes)
+{
+#if defined(__AVX2__)
+    for (; byteCount >= 4; byteCount -= 4, bytes += 4, b += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+        int32_t w = _mm256_movemask_epi8(_mm256_slli_epi64(v, 7)); // bit0 of every lane into sign bit
+        memcpy(bytes, &w, sizeof(w));
+    }
+#elif defined(__SSE2__)
+    for (; byteCount >= 2; byteCount -= 2, bytes += 2, b += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        int w = _mm_movemask_epi8(_mm_slli_epi64(v, 7)); // bit0 of every lane into sign bit
+        bytes[0] = static_cast<uint8_t>(w);
+        bytes[1] = static_cast<uint8_t>(w >> 8);
+    }
+#endif
+    for (; byteCount; byteCount--, b += 8)
+        *bytes++ = pack_byte(b);
+}
+
+bool* Modbus::getBits(const void* bitBuff, uint16_t bitNum, uint16_t bitCount, bool* boolBuff)
+{
+    const uint8_t* bits = reinterpret_cast<const uint8_t*>(bitBuff);
+    uint16_t i = 0;
+    // unaligned head
+    for (; (i < bitCount) && ((bitNum+i) % 8); i++)
+        boolBuff[i] = GET_BIT(bits, (bitNum+i));
+    uint16_t byteCount = (bitCount-i) / 8;
+    expand_bytes(&bits[(bitNum+i)/8], byteCount, &boolBuff[i]);
+    i += byteCount * 8;
+    // tail
+    for (; i < bitCount; i++)
+        boolBuff[i] = GET_BIT(bits, (bitNum+i));
+    return boolBuff;
+}
+
+void* Modbus::setBits(void* bitBuff, uint16_t bitNum, uint16_t bitCount, const bool* boolBuff)
+{
+    uint8_t* bits = reinterpret_cast<uint8_t*>(bitBuff);
+    uint16_t i = 0;
+    // unaligned head
+    for (; (i < bitCount) && ((bitNum+i) % 8); i++)
+    {
+        SET_BIT(bits, (bitNum+i), boolBuff[i])
+    }
+    uint16_t byteCount = (bitCount-i) / 8;
+    pack_bytes(&boolBuff[i], byteCount, &bits[(bitNum+i)/8]);
+    i += byteCount * 8;
+    // tail
+    for (; i < bitCount; i++)
+    {
+        SET_BIT(bits, (bitNum+i), boolBuff[i])
+    }
+    return bitBuff;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------- BIG-ENDIAN REGISTERS ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+#if defined(__ARM_NEON) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define MB_REGS_NEON 1
+#else
+#define MB_REGS_NEON 0
+#endif
+
+// swap bytes of every register of 'count' registers (8 registers per step for SSE2/NEON)
+static inline void swap_regs(const uint8_t* src, uint16_t count, uint8_t* dest)
+{
+#if defined(__SSE2__)
+    for (; count >= 8; count -= 8, src += 16, dest += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), v);
+    }
+#elif MB_REGS_NEON
+    for (; count >= 8; count -= 8, src += 16, dest += 16)
+        vst1q_u8(dest, vrev16q_u8(vld1q_u8(src)));
+#endif
+    for (; count; count--, src += 2, dest += 2)
+    {
+        uint8_t b = src[0];
+        dest[0] = src[1];
+        dest[1] = b;
+    }
+}
+
+uint16_t* Modbus::getRegsBE(const void* bytes, uint16_t count, uint16_t* values)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    memcpy(values, bytes, count*sizeof(uint16_t));
+#else
+    swap_regs(reinterpret_cast<const uint8_t*>(bytes), count, reinterpret_cast<uint8_t*>(values));
+#endif
+    return values;
+}
+
+void* Modbus::setRegsBE(void* bytes, uint16_t count, const uint16_t* values)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    memcpy(bytes, values, count*sizeof(uint16_t));
+#else
+    swap_regs(reinterpret_cast<const uint8_t*>(values), count, reinterpret_cast<uint8_t*>(bytes));
+#endif
+    return bytes;
+}
+
+bool Modbus::isBroadcast(uint8_t slave, uint8_t func)
+{
+    if (slave != BROADCAST_ADDRESS)
+        return false;
+    switch (func)
+    {
+    case MBF_FORCE_SINGLE_COIL:
+    case MBF_FORCE_SINGLE_REGISTER:
+    case MBF_FORCE_MULTIPLE_COILS:
+    case MBF_FORCE_MULTIPLE_REGISTERS:
+    case MBF_MASK_WRITE_4X_REGISTER:
+    case MBF_READ_WRITE_4X_REGISTER:
+        return true;
+    default:
+        return false;
+    }
 }
 
 uint8_t Modbus::lrc(const uint8_t* data, uint16_t szData)
@@ -69,3 +409,127 @@ void Modbus::printBytes(Stream *debug, uint8_t *bytes, uint16_t count)
     debug->print('\n');    
 }
 
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------- MODBUS INTERFACE -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// size of intermediate buffer for default implementation of 'read...RegistersBE' functions
+#define MB_INTERFACE_BE_CHUNK_REGES 16
+
+Modbus::Response ModbusInterface::readRegistersBE(ReadRegistersFunc func, uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    Modbus::Response r = Modbus::OK;
+    uint16_t values[MB_INTERFACE_BE_CHUNK_REGES];
+    uint16_t c, cn;
+    while (m_ifaceCount < count)
+    {
+        c = count-m_ifaceCount;
+        if (c > MB_INTERFACE_BE_CHUNK_REGES)
+            c = MB_INTERFACE_BE_CHUNK_REGES;
+        cn = c;
+        r = (this->*func)(slave, offset+m_ifaceCount, c, values, &cn);
+        if (r == Modbus::PROCESSING) // current chunk will be repeated by next call
+            return r;
+        if (r)
+        {
+            // when returns illegal address not in first cycle - it's normal
+            if (r == Modbus::ILLEGAL_DATA_ADDRESS && m_ifaceCount > 0)
+                r = Modbus::OK;
+            break;
+        }
+        Modbus::setRegsBE(&reinterpret_cast<uint8_t*>(bytes)[m_ifaceCount*2], cn, values);
+        m_ifaceCount += cn;
+        if (cn < c) // end of device memory
+            break;
+    }
+    if ((r == Modbus::OK) && fact)
+        *fact = m_ifaceCount;
+    m_ifaceCount = 0;
+    return r;
+}
+
+Modbus::Response ModbusInterface::readHoldingRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    return readRegistersBE(&ModbusInterface::readHoldingRegisters, slave, offset, count, bytes, fact);
+}
+
+Modbus::Response ModbusInterface::readInputRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    return readRegistersBE(&ModbusInterface::readInputRegisters, slave, offset, count, bytes, fact);
+}
+
+Modbus::Response ModbusInterface::maskWriteRegister(uint8_t &slave, uint16_t offset, uint16_t andMask, uint16_t orMask)
+{
+    Modbus::Response r;
+    uint16_t value;
+    if (m_ifaceStep == 0) // register is not read yet
+    {
+        r = readHoldingRegisters(slave, offset, 1, &value);
+        if (r != Modbus::OK)
+            return r;
+        m_ifaceCount = (value & andMask) | (orMask & ~andMask); // value to write is kept between calls
+        m_ifaceStep = 1;
+    }
+    r = forceSingleRegister(slave, offset, m_ifaceCount);
+    if (r != Modbus::PROCESSING)
+    {
+        m_ifaceCount = 0;
+        m_ifaceStep = 0;
+    }
+    return r;
+}
+
+Modbus::Response ModbusInterface::readWriteMultipleRegisters(uint8_t &slave, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact)
+{
+    Modbus::Response r;
+    if (m_ifaceStep == 0) // write is not finished yet
+    {
+        r = forceMultipleRegisters(slave, writeOffset, writeCount, writeValues);
+        if (r != Modbus::OK)
+            return r;
+        m_ifaceStep = 1;
+    }
+    r = readHoldingRegisters(slave, readOffset, readCount, readValues, fact);
+    if (r != Modbus::PROCESSING)
+        m_ifaceStep = 0;
+    return r;
+}
+
+Modbus::Response ModbusInterface::readWriteMultipleRegistersBE(uint8_t &slave, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact)
+{
+    Modbus::Response r;
+    uint16_t values[MB_INTERFACE_BE_CHUNK_REGES];
+    uint16_t c, cn;
+    while ((m_ifaceStep == 0) && (m_ifaceCount < writeCount))
+    {
+        c = writeCount-m_ifaceCount;
+        if (c > MB_INTERFACE_BE_CHUNK_REGES)
+            c = MB_INTERFACE_BE_CHUNK_REGES;
+        Modbus::getRegsBE(&reinterpret_cast<const uint8_t*>(writeBytes)[m_ifaceCount*2], c, values);
+        cn = c;
+        r = forceMultipleRegisters(slave, writeOffset+m_ifaceCount, c, values, &cn);
+        if (r == Modbus::PROCESSING) // current chunk will be repeated by next call
+            return r;
+        if (r)
+        {
+            // when returns illegal address not in first cycle - it's normal
+            if (r == Modbus::ILLEGAL_DATA_ADDRESS && m_ifaceCount > 0)
+                break;
+            m_ifaceCount = 0;
+            return r;
+        }
+        m_ifaceCount += cn;
+        if (cn < c) // end of device memory
+            break;
+    }
+    if (m_ifaceStep == 0) // write is finished: cursor is used by read part
+    {
+        m_ifaceCount = 0;
+        m_ifaceStep = 1;
+    }
+    r = readHoldingRegistersBE(slave, readOffset, readCount, readBytes, fact);
+    if (r != Modbus::PROCESSING)
+        m_ifaceStep = 0;
+    return r;
+}
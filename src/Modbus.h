@@ -128,6 +128,14 @@
 // 2040 = 255(count_of_bytes-byte in function readCoilStatus etc) * 8 (bits in byte) 
 #define MB_MAX_DISCRETS 2040
 
+// maximum count of values in one request by Modbus specification
+// (used by ModbusMaster to split large transfers into frames)
+#define MB_MAX_READ_REGISTERS 125
+#define MB_MAX_WRITE_REGISTERS 123
+#define MB_MAX_READ_DISCRETS 2000
+#define MB_MAX_WRITE_DISCRETS 1968
+#define MB_MAX_RW_WRITE_REGISTERS 121  // write part of Read/Write Multiple Registers (FC23)
+
 // --------------------------------------------------------------------------------------------------------
 // ---------------------------------------------- Buffer size ---------------------------------------------
 // --------------------------------------------------------------------------------------------------------
@@ -138,6 +146,13 @@
 // 6 bytes(tcp-prefix)+1 byte(slave)+1 byte(function)+256 bytes(maximum data length e.g. readCoilStatus etc)
 #define MB_TCP_IO_BUFF_SZ 266
 
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- CRC16 ------------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Initial value of RTU CRC16: crc16(data, sz) == crc16_update(MB_CRC16_INIT, data, sz)
+#define MB_CRC16_INIT 0xFFFF
+
 
 // --------------------------------------------------------------------------------------------------------
 // ------------------------------------------- Modbus namespace -------------------------------------------
@@ -156,6 +171,7 @@ namespace Modbus
 
 enum Constants
 {
+    BROADCAST_ADDRESS = 0,
     VALID_MODBUS_ADDRESS_BEGIN = 1,
     VALID_MODBUS_ADDRESS_END = 247,
     STANDARD_TCP_PORT = 502
@@ -190,10 +206,14 @@ enum Response
     SLAVE_DEVICE_BUSY                   = 6,
     NEGATIVE_ACKNOWLEDGE                = 7,
     MEMORY_PARITY_ERROR                 = 8,
+    GATEWAY_PATH_UNAVAILABLE            = 10,
+    GATEWAY_TARGET_DEVICE_FAILED_TO_RESPOND = 11,
     CMN_ERR_NO_RESPONSE                 = 32,
     CMN_ERR_NOT_CORRECT                 = 33,
     CMN_ERR_READ_BUFF_OVERFLOW          = 34,
     CMN_ERR_WRITE_BUFF_OVERFLOW         = 35,
+    CMN_ERR_CIRCUIT_OPEN                = 36,
+    CMN_ERR_CANCELED                    = 37,
     SERIAL_ERR_OPEN                     = 64,
     SERIAL_ERR_READ                     = 65,
     SERIAL_ERR_WRITE                    = 66,
@@ -233,19 +253,29 @@ enum Address
 // --------------------------------------------------------------------------------------------------------
 
 uint16_t crc16(const uint8_t* data, uint16_t szData);
+uint16_t crc16_update(uint16_t crc, uint8_t byte);
+uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint16_t szData);
 uint8_t lrc(const uint8_t* data, uint16_t szData);
 void printBytes(Stream *debug, uint8_t *bytes, uint16_t count);
 
+// Convert 'count' big-endian (network order) registers from/to bytes buffer
+uint16_t* getRegsBE(const void* bytes, uint16_t count, uint16_t* values);
+void* setRegsBE(void* bytes, uint16_t count, const uint16_t* values);
+
+// Returns true if request is a broadcast on serial line: write function (5, 6, 15, 16, 22, 23)
+// to BROADCAST_ADDRESS. Slaves don't respond to broadcast
+bool isBroadcast(uint8_t slave, uint8_t func);
+
 inline bool getBit(const void* bitBuff, uint16_t bitNum) { return GET_BIT (bitBuff, bitNum); }
 inline bool getBit(const void* bitBuff, uint16_t bitNum, uint16_t maxBitCount) { return (bitNum < maxBitCount) ? getBit(bitBuff, bitNum) : false; }
 
 inline void setBit(void* bitBuff, uint16_t bitNum, bool value) { SET_BIT (bitBuff, bitNum, value) }
 inline void setBit(void* bitBuff, uint16_t bitNum, bool value, uint16_t maxBitCount) { if (bitNum < maxBitCount) setBit(bitBuff, bitNum, value); }
 
-inline bool* getBits(const void* bitBuff, uint16_t bitNum, uint16_t bitCount, bool* boolBuff) { GET_BITS(bitBuff, bitNum, bitCount, boolBuff) return boolBuff; }
+bool* getBits(const void* bitBuff, uint16_t bitNum, uint16_t bitCount, bool* boolBuff);
 inline bool* getBits(const void* bitBuff, uint16_t bitNum, uint16_t bitCount, bool* boolBuff, uint16_t maxBitCount) { if (bitNum < maxBitCount) getBits(bitBuff, bitNum, bitCount, boolBuff); return boolBuff; }
 
-inline void* setBits(void* bitBuff, uint16_t bitNum, uint16_t bitCount, const bool* boolBuff) { SET_BITS(bitBuff, bitNum, bitCount, boolBuff) return bitBuff; }
+void* setBits(void* bitBuff, uint16_t bitNum, uint16_t bitCount, const bool* boolBuff);
 inline void* setBits(void* bitBuff, uint16_t bitNum, uint16_t bitCount, const bool* boolBuff, uint16_t maxBitCount) { if (bitNum < maxBitCount) setBits(bitBuff, bitNum, bitCount, boolBuff); return bitBuff; }
 
 }; // namespace Modbus
@@ -260,7 +290,7 @@ inline void* setBits(void* bitBuff, uint16_t bitNum, uint16_t bitCount, const bo
 Main ModbusInterface parameters:
 * slave     - unsigned 8 bit integer reference value that represents modbus slave address  
               It may be NULL and in this case you can get the real address of remote device
-              Valid values: 0       - for shared address
+              Valid values: 0       - for shared address (for write functions on serial line - broadcast, see `Modbus::isBroadcast`)
                           [1..247]  - valid device's address range    
 * offset    - unsigned 16 bit integer that represents address offset, e.g. 400001 address has 0-offset (in most cases)
 * count     - unsigned 16 bit integer that represents count of bits/registers to read/write
@@ -278,6 +308,20 @@ mb.forceMultipleCoils(slave, 0, 4, &values);
 ```
               
 * values    - array of unsigned 16 bit integer register's buffer to read/write
+* bytes     - buffer of registers in big-endian (network) byte order, exactly as they are placed in modbus PDU.
+              It's used by `read...RegistersBE` functions that let the slave put registers directly into the output buffer.
+              Default implementation calls `read...Registers` by chunks of 16 registers and converts values.
+              Position of current chunk is kept between calls that return Modbus::PROCESSING,
+              but it's more effective to override it for classes that execute functions asynchronously (like ModbusMaster)
+* andMask, orMask - masks of `maskWriteRegister` (FC22): result = (current & andMask) | (orMask & ~andMask).
+              Default implementation reads register and writes it back with `forceSingleRegister`,
+              so it's not atomic. Current step is kept between calls that return Modbus::PROCESSING
+* readOffset, readCount, readValues/readBytes, writeOffset, writeCount, writeValues/writeBytes - 
+              parameters of `readWriteMultipleRegisters` (FC23) for read and write parts of holding registers.
+              Write is performed before read, so registers that are both written and read return new values.
+              `readBytes` may be the same buffer as `writeBytes`: write values are taken before read values are stored.
+              Default implementation calls `forceMultipleRegisters` and then `readHoldingRegisters`(`BE`),
+              so it's not atomic. Current step is kept between calls that return Modbus::PROCESSING
 * fact      - unnecessary output parameter. May be NULL. 
               It's pointer to unsigned 16 bit integer that means the factual count of read/write values.
               
@@ -294,15 +338,31 @@ Returned value:
 
 class ModbusInterface
 {
+public:
+    ModbusInterface() : m_ifaceCount(0), m_ifaceStep(0) {}
+
 public:
     virtual Modbus::Response readCoilStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR) = 0;
     virtual Modbus::Response readInputStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR) = 0;
     virtual Modbus::Response readHoldingRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR) = 0;
     virtual Modbus::Response readInputRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR) = 0;
+    virtual Modbus::Response readHoldingRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readInputRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response forceSingleCoil(uint8_t &slave, uint16_t offset, bool value) = 0;
     virtual Modbus::Response forceSingleRegister(uint8_t &slave, uint16_t offset, uint16_t value) = 0;
     virtual Modbus::Response forceMultipleCoils(uint8_t &slave, uint16_t offset, uint16_t count, const void* bits, uint16_t* fact = MB_NULLPTR) = 0;
     virtual Modbus::Response forceMultipleRegisters(uint8_t &slave, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR) = 0;
+    virtual Modbus::Response maskWriteRegister(uint8_t &slave, uint16_t offset, uint16_t andMask, uint16_t orMask);
+    virtual Modbus::Response readWriteMultipleRegisters(uint8_t &slave, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readWriteMultipleRegistersBE(uint8_t &slave, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact = MB_NULLPTR);
+
+private:
+    typedef Modbus::Response (ModbusInterface::*ReadRegistersFunc)(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact);
+    Modbus::Response readRegistersBE(ReadRegistersFunc func, uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact);
+
+private: // state of default implementations that is kept between calls returning Modbus::PROCESSING
+    uint16_t m_ifaceCount;
+    uint8_t m_ifaceStep;
 };
 
 
@@ -0,0 +1,121 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusAdaptiveTimeout.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------ MODBUS ADAPTIVE TIMEOUT -------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusAdaptiveTimeout::ModbusAdaptiveTimeout(unsigned long minTimeout, unsigned long maxTimeout)
+{
+    m_min = minTimeout;
+    m_max = maxTimeout;
+    m_initial = maxTimeout;
+    m_maxBackoff = MODBUS_ADAPTIVE_TIMEOUT_BACKOFF;
+    reset();
+}
+
+unsigned long ModbusAdaptiveTimeout::timeout(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    unsigned long t;
+    uint8_t i;
+
+    if (!e)
+        return bound(m_initial);
+    if (e->samples)
+        t = bound((e->srtt8 >> 3) + (e->rttvar4 ? e->rttvar4 : 1)); // SRTT + 4*RTTVAR (clock granularity is 1 ms)
+    else
+        t = bound(m_initial);
+    for (i = 0; (i < e->backoff) && (i < m_maxBackoff) && (t < m_max); i++)
+        t = bound(t*2);
+    return t;
+}
+
+unsigned long ModbusAdaptiveTimeout::srtt(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return (e && e->samples) ? (e->srtt8 >> 3) : 0;
+}
+
+unsigned long ModbusAdaptiveTimeout::rttvar(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return (e && e->samples) ? (e->rttvar4 >> 2) : 0;
+}
+
+uint16_t ModbusAdaptiveTimeout::samples(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? e->samples : 0;
+}
+
+void ModbusAdaptiveTimeout::sample(uint8_t slave, unsigned long time)
+{
+    Entry* e = m_entries.get(slave, millis());
+    long delta;
+
+    if (time > m_max) // late response can't be greater than timeout
+        time = m_max;
+    if (e->samples)
+    {
+        delta = static_cast<long>(time) - static_cast<long>(e->srtt8 >> 3);
+        e->srtt8 = static_cast<unsigned long>(static_cast<long>(e->srtt8) + delta); // SRTT += (R-SRTT)/8
+        if (delta < 0)
+            delta = -delta;
+        delta -= static_cast<long>(e->rttvar4 >> 2);
+        e->rttvar4 = static_cast<unsigned long>(static_cast<long>(e->rttvar4) + delta); // RTTVAR += (|R-SRTT|-RTTVAR)/4
+    }
+    else // first response: SRTT = R, RTTVAR = R/2
+    {
+        e->srtt8 = time << 3;
+        e->rttvar4 = time << 1;
+    }
+    if (e->samples < 0xFFFF)
+        e->samples++;
+    e->backoff = 0;
+}
+
+void ModbusAdaptiveTimeout::expired(uint8_t slave)
+{
+    Entry* e = m_entries.get(slave, millis());
+    if (e->backoff < m_maxBackoff)
+        e->backoff++;
+}
+
+void ModbusAdaptiveTimeout::reset()
+{
+    m_entries.clear();
+}
+
+unsigned long ModbusAdaptiveTimeout::bound(unsigned long timeout) const
+{
+    if (timeout < m_min)
+        return m_min;
+    if (timeout > m_max)
+        return m_max;
+    return timeout;
+}
@@ -0,0 +1,112 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSADAPTIVETIMEOUT_H
+#define MODBUSADAPTIVETIMEOUT_H
+
+#include "ModbusSlaveTable.h"
+
+// count of slaves which response time is tracked by one ModbusAdaptiveTimeout object
+#ifndef MODBUS_ADAPTIVE_TIMEOUT_SLAVES
+#define MODBUS_ADAPTIVE_TIMEOUT_SLAVES 8
+#endif
+
+// default bounds of adaptive timeout (milliseconds)
+#ifndef MODBUS_ADAPTIVE_TIMEOUT_MIN
+#define MODBUS_ADAPTIVE_TIMEOUT_MIN 20
+#endif
+
+#ifndef MODBUS_ADAPTIVE_TIMEOUT_MAX
+#define MODBUS_ADAPTIVE_TIMEOUT_MAX 5000
+#endif
+
+// default maximum count of timeout doublings of not responding slave (timeout is multiplied by 16 at most)
+#ifndef MODBUS_ADAPTIVE_TIMEOUT_BACKOFF
+#define MODBUS_ADAPTIVE_TIMEOUT_BACKOFF 4
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------ MODBUS ADAPTIVE TIMEOUT -------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusAdaptiveTimeout learns response time of every slave and gives timeout for its next request
+    like TCP retransmission timer (Jacobson/Karels): smoothed response time SRTT and its variation RTTVAR
+    are updated by every response (SRTT += (R-SRTT)/8, RTTVAR += (|R-SRTT|-RTTVAR)/4) and timeout is
+    SRTT + 4*RTTVAR. Every expired timeout doubles timeout of slave (Karn's backoff) until response is received,
+    but not more than 'maxBackoff' times: so slave that stops responding costs a few of its usual response times
+    per request instead of 'maxTimeout'. Slave which response time grows more than 2^maxBackoff times at once
+    never answers in time, so increase 'maxBackoff' for such devices.
+    Timeout is limited by [minTimeout, maxTimeout], slave without responses has 'initialTimeout'.
+    It's set to ModbusMasterRTU/ModbusMasterTCP by 'setAdaptiveTimeout' instead of their fixed timeout.
+    Response times of up to MODBUS_ADAPTIVE_TIMEOUT_SLAVES slaves are kept by address (unit id), so use
+    separate object for every serial line or TCP connection. Slave that was not requested for longest time
+    gives its place to new one and starts from 'initialTimeout' again when it's requested later.
+*/
+class ModbusAdaptiveTimeout
+{
+public:
+    ModbusAdaptiveTimeout(unsigned long minTimeout = MODBUS_ADAPTIVE_TIMEOUT_MIN, unsigned long maxTimeout = MODBUS_ADAPTIVE_TIMEOUT_MAX);
+
+public:
+    inline unsigned long minTimeout() const { return m_min; }
+    inline void setMinTimeout(unsigned long timeout) { m_min = timeout; }
+    inline unsigned long maxTimeout() const { return m_max; }
+    inline void setMaxTimeout(unsigned long timeout) { m_max = timeout; }
+    inline unsigned long initialTimeout() const { return m_initial; }
+    inline void setInitialTimeout(unsigned long timeout) { m_initial = timeout; }
+    inline uint8_t maxBackoff() const { return m_maxBackoff; }
+    inline void setMaxBackoff(uint8_t count) { m_maxBackoff = count; }
+
+public:
+    unsigned long timeout(uint8_t slave) const;
+    unsigned long srtt(uint8_t slave) const;
+    unsigned long rttvar(uint8_t slave) const;
+    uint16_t samples(uint8_t slave) const;
+    void sample(uint8_t slave, unsigned long time);
+    void expired(uint8_t slave);
+    void reset();
+
+private:
+    struct Entry
+    {
+        uint8_t slave;
+        uint8_t backoff;        // count of timeout doublings since last response
+        uint16_t samples;       // count of responses (0 - slave has no responses)
+        unsigned long srtt8;    // smoothed response time * 8 (milliseconds)
+        unsigned long rttvar4;  // response time variation * 4 (milliseconds)
+        unsigned long last;     // time (millis) of last use (0 - entry is free)
+    };
+
+private:
+    unsigned long bound(unsigned long timeout) const;
+
+private:
+    unsigned long m_min;
+    unsigned long m_max;
+    unsigned long m_initial;
+    uint8_t m_maxBackoff;
+    ModbusSlaveTable<Entry, MODBUS_ADAPTIVE_TIMEOUT_SLAVES> m_entries;
+};
+
+#endif // MODBUSADAPTIVETIMEOUT_H
@@ -0,0 +1,202 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusHealth.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- MODBUS HEALTH -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// kind of request result for health of slave
+enum Outcome
+{
+    OUTCOME_SUCCESS     ,
+    OUTCOME_TIMEOUT     ,
+    OUTCOME_CRC         ,
+    OUTCOME_EXCEPTION   ,
+    OUTCOME_NONE            // local error (e.g. write to port), it says nothing about slave
+};
+
+static Outcome outcome(Modbus::Response r)
+{
+    switch (static_cast<int>(r))
+    {
+    case Modbus::CMN_ERR_NO_RESPONSE:
+    case Modbus::SERIAL_ERR_READ:
+    case Modbus::TCP_ERR_CONNECT:
+    case Modbus::TCP_ERR_RECV:
+        return OUTCOME_TIMEOUT;
+    case Modbus::CMN_ERR_NOT_CORRECT:
+    case Modbus::RTU_ERR_CRC:
+        return OUTCOME_CRC;
+    case Modbus::SLAVE_DEVICE_FAILURE:
+    case Modbus::SLAVE_DEVICE_BUSY:
+    case Modbus::MEMORY_PARITY_ERROR:
+    case Modbus::GATEWAY_PATH_UNAVAILABLE:
+    case Modbus::GATEWAY_TARGET_DEVICE_FAILED_TO_RESPOND:
+    case Modbus::UNKNOWN_ERROR:
+        return OUTCOME_EXCEPTION;
+    default:
+        if ((r >= Modbus::OK) && (r < Modbus::CMN_ERR_NO_RESPONSE)) // response or other exception: device is alive
+            return OUTCOME_SUCCESS;
+        return OUTCOME_NONE;
+    }
+}
+
+ModbusHealth::ModbusHealth(uint8_t threshold, unsigned long probeInterval, unsigned long maxProbeInterval)
+{
+    setThreshold(threshold);
+    m_probeMin = probeInterval;
+    m_probeMax = maxProbeInterval;
+    reset();
+}
+
+bool ModbusHealth::allow(uint8_t slave)
+{
+    Entry* e = m_entries.find(slave);
+
+    if (!e || (e->state == STATE_CLOSED))
+        return true;
+    // circuit is open or probe is lost (its result was not received): send probe after interval
+    if (millis()-e->since < interval(e))
+        return false;
+    e->state = STATE_HALF_OPEN;
+    e->since = millis();
+    return true;
+}
+
+void ModbusHealth::result(uint8_t slave, Modbus::Response r)
+{
+    Outcome o = outcome(r);
+    Entry* e;
+
+    if (o == OUTCOME_NONE)
+        return;
+    if (o == OUTCOME_SUCCESS)
+    {
+        e = m_entries.find(slave);
+        if (e)
+        {
+            e->state = STATE_CLOSED;
+            e->failures = 0;
+            e->backoff = 0;
+            m_entries.touch(e, millis());
+        }
+        return;
+    }
+    e = m_entries.get(slave, millis(), isSpare);
+    switch (o)
+    {
+    case OUTCOME_TIMEOUT:
+        count(e->timeouts);
+        break;
+    case OUTCOME_CRC:
+        count(e->crcErrors);
+        break;
+    default:
+        count(e->exceptions);
+        break;
+    }
+    if (e->failures < 0xFF)
+        e->failures++;
+    switch (e->state)
+    {
+    case STATE_CLOSED:
+        if (e->failures < m_threshold)
+            break;
+        e->state = STATE_OPEN;
+        e->since = millis();
+        break;
+    case STATE_HALF_OPEN: // probe is failed
+        if (interval(e) < m_probeMax)
+            e->backoff++;
+        e->state = STATE_OPEN;
+        e->since = millis();
+        break;
+    default:
+        break;
+    }
+}
+
+ModbusHealth::State ModbusHealth::state(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? static_cast<State>(e->state) : STATE_CLOSED;
+}
+
+uint8_t ModbusHealth::failures(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? e->failures : 0;
+}
+
+uint16_t ModbusHealth::timeouts(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? e->timeouts : 0;
+}
+
+uint16_t ModbusHealth::crcErrors(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? e->crcErrors : 0;
+}
+
+uint16_t ModbusHealth::exceptions(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? e->exceptions : 0;
+}
+
+unsigned long ModbusHealth::probeInterval(uint8_t slave) const
+{
+    const Entry* e = m_entries.find(slave);
+    return e ? interval(e) : m_probeMin;
+}
+
+void ModbusHealth::reset()
+{
+    m_entries.clear();
+}
+
+// healthy slave is forgotten before slave with open circuit
+bool ModbusHealth::isSpare(const Entry &e)
+{
+    return e.state == STATE_CLOSED;
+}
+
+unsigned long ModbusHealth::interval(const Entry* e) const
+{
+    unsigned long t = m_probeMin;
+    for (uint8_t i = 0; (i < e->backoff) && (t < m_probeMax); i++)
+        t *= 2;
+    return (t > m_probeMax) ? m_probeMax : t;
+}
+
+void ModbusHealth::count(uint16_t &counter)
+{
+    if (counter < 0xFFFF)
+        counter++;
+}
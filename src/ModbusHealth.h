@@ -0,0 +1,124 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSHEALTH_H
+#define MODBUSHEALTH_H
+
+#include "ModbusSlaveTable.h"
+
+// count of slaves which health is tracked by one ModbusHealth object
+#ifndef MODBUS_HEALTH_SLAVES
+#define MODBUS_HEALTH_SLAVES 8
+#endif
+
+// default count of consecutive failures that opens circuit of slave
+#ifndef MODBUS_HEALTH_THRESHOLD
+#define MODBUS_HEALTH_THRESHOLD 3
+#endif
+
+// default bounds of interval between probe requests to slave with open circuit (milliseconds)
+#ifndef MODBUS_HEALTH_PROBE_MIN
+#define MODBUS_HEALTH_PROBE_MIN 1000
+#endif
+
+#ifndef MODBUS_HEALTH_PROBE_MAX
+#define MODBUS_HEALTH_PROBE_MAX 60000
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- MODBUS HEALTH -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusHealth counts failures of every slave and works as circuit breaker for it.
+    Failure is timeout (no response), CRC error, not correct response and exception that means that device
+    can't serve requests (4 - slave device failure, 6 - busy, 8 - memory parity error, 10/11 - gateway errors).
+    Any other response (including exceptions 1, 2, 3 - device is alive) is success and resets count of failures.
+    After 'threshold' consecutive failures circuit of slave is opened: master returns
+    Modbus::CMN_ERR_CIRCUIT_OPEN at once without request, only one probe request is sent after 'probeInterval'.
+    Every failed probe doubles interval up to 'maxProbeInterval', successful probe closes circuit.
+    It's set to ModbusMaster by 'setHealth' (set the same object to all channels of ModbusMasterTCP).
+    Circuits of up to MODBUS_HEALTH_SLAVES failed slaves are tracked by address (unit id), healthy slaves take
+    no place until they fail. When table is full, healthy slave that was used longest time ago is forgotten first,
+    slaves with open circuit are kept while it's possible.
+*/
+class ModbusHealth
+{
+public:
+    enum State
+    {
+        STATE_CLOSED    ,   // slave is healthy: all requests are sent
+        STATE_OPEN      ,   // slave is failed: requests are rejected until probe interval is elapsed
+        STATE_HALF_OPEN     // probe request is sent: its result closes or opens circuit again
+    };
+
+public:
+    ModbusHealth(uint8_t threshold = MODBUS_HEALTH_THRESHOLD, unsigned long probeInterval = MODBUS_HEALTH_PROBE_MIN, unsigned long maxProbeInterval = MODBUS_HEALTH_PROBE_MAX);
+
+public:
+    inline uint8_t threshold() const { return m_threshold; }
+    inline void setThreshold(uint8_t threshold) { m_threshold = threshold ? threshold : 1; }
+    inline unsigned long probeInterval() const { return m_probeMin; }
+    inline void setProbeInterval(unsigned long interval) { m_probeMin = interval; }
+    inline unsigned long maxProbeInterval() const { return m_probeMax; }
+    inline void setMaxProbeInterval(unsigned long interval) { m_probeMax = interval; }
+
+public:
+    bool allow(uint8_t slave);
+    void result(uint8_t slave, Modbus::Response r);
+    State state(uint8_t slave) const;
+    inline bool isOpen(uint8_t slave) const { return state(slave) != STATE_CLOSED; }
+    uint8_t failures(uint8_t slave) const;
+    uint16_t timeouts(uint8_t slave) const;
+    uint16_t crcErrors(uint8_t slave) const;
+    uint16_t exceptions(uint8_t slave) const;
+    unsigned long probeInterval(uint8_t slave) const;
+    void reset();
+
+private:
+    struct Entry
+    {
+        uint8_t slave;
+        uint8_t state;          // State
+        uint8_t failures;       // count of consecutive failures
+        uint8_t backoff;        // count of probe interval doublings
+        uint16_t timeouts;      // count of timeouts (total)
+        uint16_t crcErrors;     // count of CRC and not correct responses (total)
+        uint16_t exceptions;    // count of failure exceptions (total)
+        unsigned long since;    // time (millis) when circuit was opened or probe was sent
+        unsigned long last;     // time (millis) of last use (0 - entry is free)
+    };
+
+private:
+    static bool isSpare(const Entry &e);
+    unsigned long interval(const Entry* e) const;
+    static void count(uint16_t &counter);
+
+private:
+    uint8_t m_threshold;
+    unsigned long m_probeMin;
+    unsigned long m_probeMax;
+    ModbusSlaveTable<Entry, MODBUS_HEALTH_SLAVES> m_entries;
+};
+
+#endif // MODBUSHEALTH_H
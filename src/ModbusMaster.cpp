@@ -22,14 +22,24 @@
 */
 
 #include "ModbusMaster.h"
+#include "ModbusHealth.h"
 
 #include <Arduino.h>
 
+// 'm_largeChunk' value that means master doesn't execute frame of large transfer
+static const uint16_t c_NoChunk = 0xFFFF;
+
 ModbusMaster::ModbusMaster()
 {
     m_name = MB_NULLPTR;
     m_verboseStream = MB_NULLPTR;
     m_state = STATE_UNKNOWN;
+    m_health = MB_NULLPTR;
+    m_queue = MB_NULLPTR;
+    m_queueTail = MB_NULLPTR;
+    m_queued = 0;
+    m_largeChunk = c_NoChunk;
+    m_large = false;
 }
 
 Modbus::Response ModbusMaster::readCoilStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact)
@@ -51,10 +61,10 @@ Modbus::Response ModbusMaster::readCoilStatus(uint8_t &slave, uint16_t offset, u
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                  // slave device ID
-                 MBF_READ_COIL_STATUS,   // function number
-                 4,                      // size of input bytes of data
-                 &szOutBuff);            // size of output bytes of data
+        r = request(slave,                  // slave device ID
+                    MBF_READ_COIL_STATUS,   // function number
+                    4,                      // size of input bytes of data
+                    &szOutBuff);            // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r;
         if (!szOutBuff)
@@ -93,10 +103,10 @@ Modbus::Response ModbusMaster::readInputStatus(uint8_t &slave, uint16_t offset,
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                  // slave device ID
-                 MBF_READ_INPUT_STATUS,  // function number
-                 4,                      // size of input bytes of data
-                 &szOutBuff);            // size of output bytes of data
+        r = request(slave,                  // slave device ID
+                    MBF_READ_INPUT_STATUS,  // function number
+                    4,                      // size of input bytes of data
+                    &szOutBuff);            // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r; 
         if (!szOutBuff)
@@ -135,10 +145,10 @@ Modbus::Response ModbusMaster::readHoldingRegisters(uint8_t &slave, uint16_t off
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                      // slave device ID
-                 MBF_READ_HOLDING_REGISTERS, // function number
-                 4,			                 // size of input bytes of data
-                 &szOutBuff);                // size of output bytes of data
+        r = request(slave,                      // slave device ID
+                    MBF_READ_HOLDING_REGISTERS, // function number
+                    4,			                 // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r; 
        if (!szOutBuff)
@@ -151,8 +161,48 @@ Modbus::Response ModbusMaster::readHoldingRegisters(uint8_t &slave, uint16_t off
             return Modbus::CMN_ERR_NOT_CORRECT;
         if (fact) 
             *fact = fcRegs;
-        for (int i = 0; i < fcRegs; i++)
-            values[i] = bufferByteAt(i*2+2) | (bufferByteAt(i*2+1)<<8);       
+        Modbus::getRegsBE(bufferData(1), fcRegs, values);
+        // no need break
+    }
+    return Modbus::OK;
+}
+
+Modbus::Response ModbusMaster::readHoldingRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    Modbus::Response r;
+    uint16_t szOutBuff, fcRegs, fcBytes;
+
+    switch (m_state)
+    {
+    case STATE_UNKNOWN:
+    case STATE_DISCONNECTED:
+    case STATE_CONNECTED:
+    case STATE_BEGIN_WRITE:
+        m_mem = count;
+        setBufferByteAt(0, reinterpret_cast<uint8_t*>(&offset)[1]); // start register offset - MS BYTE
+        setBufferByteAt(1, reinterpret_cast<uint8_t*>(&offset)[0]); // start register offset - LS BYTE
+        setBufferByteAt(2, reinterpret_cast<uint8_t*>(&count)[1]);  // quantity of values - MS BYTE
+        setBufferByteAt(3, reinterpret_cast<uint8_t*>(&count)[0]);  // quantity of values - LS BYTE
+        m_state = STATE_WRITE;
+        // no need break
+    default:
+        r = request(slave,                      // slave device ID
+                    MBF_READ_HOLDING_REGISTERS, // function number
+                    4,			                 // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
+        if (r != Modbus::OK) // error or processing
+            return r; 
+       if (!szOutBuff)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcBytes = bufferByteAt(0);  // count of bytes received
+        if (fcBytes != szOutBuff-1)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcRegs = fcBytes / sizeof(uint16_t); // count values received
+        if (fcRegs > m_mem) // count of values responsed is greater then requested - it's a COLLISION!!!
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        if (fact) 
+            *fact = fcRegs;
+        getBufferBytesAt(1, bytes, fcRegs*2);
         // no need break
     }
     return Modbus::OK;
@@ -177,10 +227,10 @@ Modbus::Response ModbusMaster::readInputRegisters(uint8_t &slave, uint16_t offse
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                      // slave device ID
-                 MBF_READ_INPUT_REGISTERS,   // function number
-                 4,                          // size of input bytes of data
-                 &szOutBuff);                // size of output bytes of data
+        r = request(slave,                      // slave device ID
+                    MBF_READ_INPUT_REGISTERS,   // function number
+                    4,                          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r; 
         if (!szOutBuff)
@@ -193,8 +243,48 @@ Modbus::Response ModbusMaster::readInputRegisters(uint8_t &slave, uint16_t offse
             return Modbus::CMN_ERR_NOT_CORRECT;
         if (fact) 
             *fact = fcRegs;
-        for (int i = 0; i < fcRegs; i++)
-            values[i] = bufferByteAt(i*2+2) | (bufferByteAt(i*2+1)<<8);       
+        Modbus::getRegsBE(bufferData(1), fcRegs, values);
+        // no need break
+    }
+    return Modbus::OK;
+}
+
+Modbus::Response ModbusMaster::readInputRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    Modbus::Response r;
+    uint16_t szOutBuff, fcRegs, fcBytes;
+    
+    switch (m_state)
+    {
+    case STATE_UNKNOWN:
+    case STATE_DISCONNECTED:
+    case STATE_CONNECTED:
+    case STATE_BEGIN_WRITE:
+        m_mem = count;
+        setBufferByteAt(0, reinterpret_cast<uint8_t*>(&offset)[1]); // start register offset - MS BYTE
+        setBufferByteAt(1, reinterpret_cast<uint8_t*>(&offset)[0]); // start register offset - LS BYTE
+        setBufferByteAt(2, reinterpret_cast<uint8_t*>(&m_mem)[1]);  // quantity of values - MS BYTE
+        setBufferByteAt(3, reinterpret_cast<uint8_t*>(&m_mem)[0]);  // quantity of values - LS BYTE
+        m_state = STATE_WRITE;
+        // no need break
+    default:
+        r = request(slave,                      // slave device ID
+                    MBF_READ_INPUT_REGISTERS,   // function number
+                    4,                          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
+        if (r != Modbus::OK) // error or processing
+            return r; 
+        if (!szOutBuff)
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        fcBytes = bufferByteAt(0);  // count of bytes received
+        if (fcBytes != szOutBuff-1)
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        fcRegs = fcBytes / sizeof(uint16_t); // count values received
+        if (fcRegs > m_mem) // count of values responsed is greater then requested - it's a COLLISION!!!
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        if (fact) 
+            *fact = fcRegs;
+        getBufferBytesAt(1, bytes, fcRegs*2);
         // no need break
     }
     return Modbus::OK;
@@ -219,10 +309,10 @@ Modbus::Response ModbusMaster::forceSingleCoil(uint8_t &slave, uint16_t offset,
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                  // slave device ID
-                 MBF_FORCE_SINGLE_COIL,  // function number
-                 4,                      // size of input bytes of data
-                 &szOutBuff);            // size of output bytes of data
+        r = request(slave,                  // slave device ID
+                    MBF_FORCE_SINGLE_COIL,  // function number
+                    4,                      // size of input bytes of data
+                    &szOutBuff);            // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r; 
         if (szOutBuff != 4)
@@ -255,10 +345,10 @@ Modbus::Response ModbusMaster::forceSingleRegister(uint8_t &slave, uint16_t offs
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                      // slave device ID
-                 MBF_FORCE_SINGLE_REGISTER,  // function number
-                 4,                          // size of input bytes of data
-                 &szOutBuff);                // size of output bytes of data
+        r = request(slave,                      // slave device ID
+                    MBF_FORCE_SINGLE_REGISTER,  // function number
+                    4,                          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
         if (r != Modbus::OK) // error or processing
             return r; 
         if (szOutBuff != 4)
@@ -293,10 +383,10 @@ Modbus::Response ModbusMaster::forceMultipleCoils(uint8_t &slave, uint16_t offse
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                      // slave device ID
-                 MBF_FORCE_MULTIPLE_COILS,   // function number
-                 5 + bufferByteAt(4),    // size of input bytes of data
-                 &szOutBuff);                // size of output bytes of data					   
+        r = request(slave,                      // slave device ID
+                    MBF_FORCE_MULTIPLE_COILS,   // function number
+                    5 + bufferByteAt(4),    // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data					   
         if (r != Modbus::OK) // error or processing
             return r; 
         if (szOutBuff != 4)
@@ -329,18 +419,14 @@ Modbus::Response ModbusMaster::forceMultipleRegisters(uint8_t &slave, uint16_t o
         setBufferByteAt(2, reinterpret_cast<uint8_t*>(&count)[1]);    // quantity of registers - MS BYTE
         setBufferByteAt(3, reinterpret_cast<uint8_t*>(&count)[0]);    // quantity of registers - LS BYTE
         setBufferByteAt(4, static_cast<uint8_t>(count*2));            // quantity of next bytes
-        for(int i = 0; i < count; i++)
-        {
-            setBufferByteAt(5+i*2, reinterpret_cast<const uint8_t*>(&values[i])[1]);
-            setBufferByteAt(6+i*2, reinterpret_cast<const uint8_t*>(&values[i])[0]);
-        }
+        Modbus::setRegsBE(bufferData(5), count, values);
         m_state = STATE_WRITE;
         // no need break
     default:
-        r = exec(slave,                        // slave device ID
-                 MBF_FORCE_MULTIPLE_REGISTERS, // function number
-                 5+bufferByteAt(4),        // size of input bytes of data
-                 &szOutBuff);                  // size of output bytes of data					   
+        r = request(slave,                        // slave device ID
+                    MBF_FORCE_MULTIPLE_REGISTERS, // function number
+                    5+bufferByteAt(4),        // size of input bytes of data
+                    &szOutBuff);                  // size of output bytes of data					   
         if (r != Modbus::OK) // error or processing
             return r; 
         if (szOutBuff != 4)
@@ -355,3 +441,439 @@ Modbus::Response ModbusMaster::forceMultipleRegisters(uint8_t &slave, uint16_t o
     }
     return Modbus::OK;
 }
+
+Modbus::Response ModbusMaster::maskWriteRegister(uint8_t &slave, uint16_t offset, uint16_t andMask, uint16_t orMask)
+{
+    Modbus::Response r;
+    uint16_t szOutBuff, outOffset, outAndMask, outOrMask;
+    
+    switch (m_state)
+    {
+    case STATE_UNKNOWN:
+    case STATE_DISCONNECTED:
+    case STATE_CONNECTED:
+    case STATE_BEGIN_WRITE:
+        m_memOffset = offset;
+        m_mem = andMask;
+        m_memMask = orMask;
+        setBufferByteAt(0, reinterpret_cast<uint8_t*>(&offset)[1]);     // register offset - MS BYTE
+        setBufferByteAt(1, reinterpret_cast<uint8_t*>(&offset)[0]);     // register offset - LS BYTE
+        setBufferByteAt(2, reinterpret_cast<uint8_t*>(&andMask)[1]);    // AND mask - MS BYTE
+        setBufferByteAt(3, reinterpret_cast<uint8_t*>(&andMask)[0]);    // AND mask - LS BYTE
+        setBufferByteAt(4, reinterpret_cast<uint8_t*>(&orMask)[1]);     // OR mask - MS BYTE
+        setBufferByteAt(5, reinterpret_cast<uint8_t*>(&orMask)[0]);     // OR mask - LS BYTE
+        m_state = STATE_WRITE;
+        // no need break
+    default:
+        r = request(slave,                      // slave device ID
+                    MBF_MASK_WRITE_4X_REGISTER, // function number
+                    6,                          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
+        if (r != Modbus::OK) // error or processing
+            return r; 
+        if (szOutBuff != 6)
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        outOffset = bufferByteAt(1) | (bufferByteAt(0)<<8);
+        outAndMask = bufferByteAt(3) | (bufferByteAt(2)<<8);
+        outOrMask = bufferByteAt(5) | (bufferByteAt(4)<<8);
+        if ((outOffset != m_memOffset) || (outAndMask != m_mem) || (outOrMask != m_memMask))
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        // no need break
+    }
+    return Modbus::OK;
+}
+
+Modbus::Response ModbusMaster::readWriteMultipleRegisters(uint8_t &slave, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact)
+{
+    Modbus::Response r;
+    uint16_t szOutBuff, fcRegs, fcBytes;
+
+    switch (m_state)
+    {
+    case STATE_UNKNOWN:
+    case STATE_DISCONNECTED:
+    case STATE_CONNECTED:
+    case STATE_BEGIN_WRITE:
+        if (writeCount > MB_MAX_RW_WRITE_REGISTERS)
+            return Modbus::CMN_ERR_WRITE_BUFF_OVERFLOW;
+        m_mem = readCount;
+        setBufferByteAt(0, reinterpret_cast<uint8_t*>(&readOffset)[1]);  // read start register offset - MS BYTE
+        setBufferByteAt(1, reinterpret_cast<uint8_t*>(&readOffset)[0]);  // read start register offset - LS BYTE
+        setBufferByteAt(2, reinterpret_cast<uint8_t*>(&readCount)[1]);   // quantity to read - MS BYTE
+        setBufferByteAt(3, reinterpret_cast<uint8_t*>(&readCount)[0]);   // quantity to read - LS BYTE
+        setBufferByteAt(4, reinterpret_cast<uint8_t*>(&writeOffset)[1]); // write start register offset - MS BYTE
+        setBufferByteAt(5, reinterpret_cast<uint8_t*>(&writeOffset)[0]); // write start register offset - LS BYTE
+        setBufferByteAt(6, reinterpret_cast<uint8_t*>(&writeCount)[1]);  // quantity to write - MS BYTE
+        setBufferByteAt(7, reinterpret_cast<uint8_t*>(&writeCount)[0]);  // quantity to write - LS BYTE
+        setBufferByteAt(8, static_cast<uint8_t>(writeCount*2));          // quantity of next bytes
+        Modbus::setRegsBE(bufferData(9), writeCount, writeValues);
+        m_state = STATE_WRITE;
+        // no need break
+    default:
+        r = request(slave,                      // slave device ID
+                    MBF_READ_WRITE_4X_REGISTER, // function number
+                    9+bufferByteAt(8),          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
+        if (r != Modbus::OK) // error or processing
+            return r; 
+        if (!szOutBuff)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcBytes = bufferByteAt(0);  // count of bytes received
+        if (fcBytes != szOutBuff-1)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcRegs = fcBytes / sizeof(uint16_t); // count values received
+        if (fcRegs > m_mem) // count of values responsed is greater then requested - it's a COLLISION!!!
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        if (fact) 
+            *fact = fcRegs;
+        Modbus::getRegsBE(bufferData(1), fcRegs, readValues);
+        // no need break
+    }
+    return Modbus::OK;
+}
+
+Modbus::Response ModbusMaster::readWriteMultipleRegistersBE(uint8_t &slave, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact)
+{
+    Modbus::Response r;
+    uint16_t szOutBuff, fcRegs, fcBytes;
+
+    switch (m_state)
+    {
+    case STATE_UNKNOWN:
+    case STATE_DISCONNECTED:
+    case STATE_CONNECTED:
+    case STATE_BEGIN_WRITE:
+        if (writeCount > MB_MAX_RW_WRITE_REGISTERS)
+            return Modbus::CMN_ERR_WRITE_BUFF_OVERFLOW;
+        m_mem = readCount;
+        setBufferByteAt(0, reinterpret_cast<uint8_t*>(&readOffset)[1]);  // read start register offset - MS BYTE
+        setBufferByteAt(1, reinterpret_cast<uint8_t*>(&readOffset)[0]);  // read start register offset - LS BYTE
+        setBufferByteAt(2, reinterpret_cast<uint8_t*>(&readCount)[1]);   // quantity to read - MS BYTE
+        setBufferByteAt(3, reinterpret_cast<uint8_t*>(&readCount)[0]);   // quantity to read - LS BYTE
+        setBufferByteAt(4, reinterpret_cast<uint8_t*>(&writeOffset)[1]); // write start register offset - MS BYTE
+        setBufferByteAt(5, reinterpret_cast<uint8_t*>(&writeOffset)[0]); // write start register offset - LS BYTE
+        setBufferByteAt(6, reinterpret_cast<uint8_t*>(&writeCount)[1]);  // quantity to write - MS BYTE
+        setBufferByteAt(7, reinterpret_cast<uint8_t*>(&writeCount)[0]);  // quantity to write - LS BYTE
+        setBufferByteAt(8, static_cast<uint8_t>(writeCount*2));          // quantity of next bytes
+        setBufferBytesAt(9, writeBytes, writeCount*2);
+        m_state = STATE_WRITE;
+        // no need break
+    default:
+        r = request(slave,                      // slave device ID
+                    MBF_READ_WRITE_4X_REGISTER, // function number
+                    9+bufferByteAt(8),          // size of input bytes of data
+                    &szOutBuff);                // size of output bytes of data
+        if (r != Modbus::OK) // error or processing
+            return r; 
+        if (!szOutBuff)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcBytes = bufferByteAt(0);  // count of bytes received
+        if (fcBytes != szOutBuff-1)
+            return Modbus::CMN_ERR_NOT_CORRECT;        
+        fcRegs = fcBytes / sizeof(uint16_t); // count values received
+        if (fcRegs > m_mem) // count of values responsed is greater then requested - it's a COLLISION!!!
+            return Modbus::CMN_ERR_NOT_CORRECT;
+        if (fact) 
+            *fact = fcRegs;
+        getBufferBytesAt(1, readBytes, fcRegs*2);
+        // no need break
+    }
+    return Modbus::OK;
+}
+
+// Executes request prepared by high-level function: request to slave with open circuit fails at once
+Modbus::Response ModbusMaster::request(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff)
+{
+    Modbus::Response r;
+
+    if (m_health && (m_state == STATE_WRITE) && !m_health->allow(slave))
+    {
+        m_state = STATE_BEGIN_WRITE;
+        return Modbus::CMN_ERR_CIRCUIT_OPEN;
+    }
+    r = exec(slave, func, szInBuff, szOutBuff);
+    if (m_health && (r != Modbus::PROCESSING))
+        m_health->result(slave, r);
+    return r;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- REQUEST QUEUE --------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Adds request to the end of queue. Returns false if request is already in queue.
+bool ModbusMaster::submit(ModbusRequest* request)
+{
+    if (isQueued(request)) // queue is checked instead of status: status of new request can be garbage
+        return false;
+    request->status = Modbus::PROCESSING;
+    request->fact = 0;
+    request->next = MB_NULLPTR;
+    if (m_queueTail)
+        m_queueTail->next = request;
+    else
+        m_queue = request;
+    m_queueTail = request;
+    m_queued++;
+    return true;
+}
+
+// Removes request from queue without callback. Request that is in process already (first in queue) can't be canceled.
+bool ModbusMaster::cancel(ModbusRequest* request)
+{
+    ModbusRequest* prev;
+
+    if (!m_queue || (request == m_queue))
+        return false;
+    for (prev = m_queue; prev->next && (prev->next != request); prev = prev->next);
+    if (!prev->next)
+        return false;
+    prev->next = request->next;
+    if (m_queueTail == request)
+        m_queueTail = prev;
+    m_queued--;
+    request->status = Modbus::CMN_ERR_CANCELED;
+    return true;
+}
+
+bool ModbusMaster::isQueued(const ModbusRequest* request) const
+{
+    const ModbusRequest* q;
+
+    for (q = m_queue; q; q = q->next)
+    {
+        if (q == request)
+            return true;
+    }
+    return false;
+}
+
+// Executes first request of queue; when it's completed it's removed from queue and its callback is called
+// (callback can submit the same or other request again).
+void ModbusMaster::poll()
+{
+    ModbusRequest* q = m_queue;
+    Modbus::Response r;
+
+    if (!q)
+        return;
+    r = execRequest(q);
+    if (r == Modbus::PROCESSING)
+        return;
+    m_queue = q->next;
+    if (!m_queue)
+        m_queueTail = MB_NULLPTR;
+    m_queued--;
+    q->status = r;
+    if (q->callback)
+        q->callback(q);
+}
+
+Modbus::Response ModbusMaster::execRequest(ModbusRequest* q)
+{
+    const uint16_t* v = static_cast<const uint16_t*>(q->data);
+    Modbus::Response r;
+
+    switch (q->func)
+    {
+    case MBF_READ_COIL_STATUS:
+        if (q->count > MB_MAX_READ_DISCRETS)
+            return readCoilStatusLarge(q->slave, q->offset, q->count, q->data, &q->fact);
+        return readCoilStatus(q->slave, q->offset, q->count, q->data, &q->fact);
+    case MBF_READ_INPUT_STATUS:
+        if (q->count > MB_MAX_READ_DISCRETS)
+            return readInputStatusLarge(q->slave, q->offset, q->count, q->data, &q->fact);
+        return readInputStatus(q->slave, q->offset, q->count, q->data, &q->fact);
+    case MBF_READ_HOLDING_REGISTERS:
+        if (q->count > MB_MAX_READ_REGISTERS)
+            return readHoldingRegistersLarge(q->slave, q->offset, q->count, static_cast<uint16_t*>(q->data), &q->fact);
+        return readHoldingRegisters(q->slave, q->offset, q->count, static_cast<uint16_t*>(q->data), &q->fact);
+    case MBF_READ_INPUT_REGISTERS:
+        if (q->count > MB_MAX_READ_REGISTERS)
+            return readInputRegistersLarge(q->slave, q->offset, q->count, static_cast<uint16_t*>(q->data), &q->fact);
+        return readInputRegisters(q->slave, q->offset, q->count, static_cast<uint16_t*>(q->data), &q->fact);
+    case MBF_FORCE_SINGLE_COIL:
+        r = forceSingleCoil(q->slave, q->offset, Modbus::getBit(q->data, 0));
+        break;
+    case MBF_FORCE_SINGLE_REGISTER:
+        r = forceSingleRegister(q->slave, q->offset, v[0]);
+        break;
+    case MBF_FORCE_MULTIPLE_COILS:
+        if (q->count > MB_MAX_WRITE_DISCRETS)
+            return forceMultipleCoilsLarge(q->slave, q->offset, q->count, q->data, &q->fact);
+        return forceMultipleCoils(q->slave, q->offset, q->count, q->data, &q->fact);
+    case MBF_FORCE_MULTIPLE_REGISTERS:
+        if (q->count > MB_MAX_WRITE_REGISTERS)
+            return forceMultipleRegistersLarge(q->slave, q->offset, q->count, v, &q->fact);
+        return forceMultipleRegisters(q->slave, q->offset, q->count, v, &q->fact);
+    case MBF_MASK_WRITE_4X_REGISTER:
+        r = maskWriteRegister(q->slave, q->offset, v[0], v[1]);
+        break;
+    case MBF_READ_WRITE_4X_REGISTER:
+        return readWriteMultipleRegisters(q->slave, q->offset, q->count, static_cast<uint16_t*>(q->data), q->writeOffset, q->writeCount, static_cast<const uint16_t*>(q->writeData), &q->fact);
+    default:
+        return Modbus::ILLEGAL_FUNCTION;
+    }
+    if (r == Modbus::OK) // single value is written
+        q->fact = 1;
+    return r;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------- LARGE TRANSFERS --------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+Modbus::Response ModbusMaster::readCoilStatusLarge(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact)
+{
+    return execLarge(MBF_READ_COIL_STATUS, slave, offset, count, bits, fact);
+}
+
+Modbus::Response ModbusMaster::readInputStatusLarge(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact)
+{
+    return execLarge(MBF_READ_INPUT_STATUS, slave, offset, count, bits, fact);
+}
+
+Modbus::Response ModbusMaster::readHoldingRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
+{
+    return execLarge(MBF_READ_HOLDING_REGISTERS, slave, offset, count, values, fact);
+}
+
+Modbus::Response ModbusMaster::readInputRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
+{
+    return execLarge(MBF_READ_INPUT_REGISTERS, slave, offset, count, values, fact);
+}
+
+Modbus::Response ModbusMaster::forceMultipleCoilsLarge(uint8_t &slave, uint16_t offset, uint16_t count, const void* bits, uint16_t* fact)
+{
+    return execLarge(MBF_FORCE_MULTIPLE_COILS, slave, offset, count, const_cast<void*>(bits), fact);
+}
+
+Modbus::Response ModbusMaster::forceMultipleRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
+{
+    return execLarge(MBF_FORCE_MULTIPLE_REGISTERS, slave, offset, count, const_cast<uint16_t*>(values), fact);
+}
+
+Modbus::Response ModbusMaster::execLarge(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t* fact)
+{
+    ModbusMaster* p;
+    Modbus::Response r;
+    uint16_t chunk, chunks, c, cnt, f;
+    uint32_t done;
+    uint8_t i;
+    bool inProcess;
+    
+    switch (func)
+    {
+    case MBF_READ_COIL_STATUS:
+    case MBF_READ_INPUT_STATUS:
+        chunk = MB_MAX_READ_DISCRETS;
+        break;
+    case MBF_READ_HOLDING_REGISTERS:
+    case MBF_READ_INPUT_REGISTERS:
+        chunk = MB_MAX_READ_REGISTERS;
+        break;
+    case MBF_FORCE_MULTIPLE_COILS:
+        chunk = MB_MAX_WRITE_DISCRETS;
+        break;
+    default:
+        chunk = MB_MAX_WRITE_REGISTERS;
+        break;
+    }
+    // addresses of frames must not wrap around the end of modbus table
+    if (static_cast<uint32_t>(offset)+count > 0x10000UL)
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+    chunks = (static_cast<uint32_t>(count)+chunk-1) / chunk;
+    if (!chunks)
+        chunks = 1;
+    if (!m_large) // begin new transfer
+    {
+        m_large = true;
+        m_largeNext = 0;
+        m_largeEnd = chunks;
+        m_largeEndFact = 0;
+        m_largeResult = Modbus::OK;
+    }
+    // this master and masters that share its connection (pipelining) execute frames back-to-back
+    inProcess = false;
+    for (i = 0, p = this; p; p = pipelineMaster(i++))
+    {
+        for (;;)
+        {
+            if (p->m_largeChunk == c_NoChunk)
+            {
+                if ((m_largeNext >= m_largeEnd) || !p->isIdle())
+                    break;
+                p->m_largeChunk = m_largeNext++;
+            }
+            c = p->m_largeChunk;
+            cnt = (c == chunks-1) ? count-c*chunk : chunk;
+            f = 0;
+            r = p->execChunk(func, slave, offset+c*chunk, cnt, data, c*chunk, &f);
+            if (r == Modbus::PROCESSING)
+            {
+                inProcess = true;
+                break;
+            }
+            p->m_largeChunk = c_NoChunk;
+            if (((r != Modbus::OK) || (f < cnt)) && (c < m_largeEnd)) // frame is not transferred completely: transfer ends on it
+            {
+                m_largeEnd = c;
+                m_largeEndFact = (r == Modbus::OK) ? f : 0;
+                m_largeResult = r;
+            }
+        }
+    }
+    if (!inProcess && (m_largeNext >= m_largeEnd)) // transfer is finished
+    {
+        m_large = false;
+        done = static_cast<uint32_t>(m_largeEnd)*chunk + m_largeEndFact;
+        if (fact)
+            *fact = (done < count) ? static_cast<uint16_t>(done) : count;
+        return m_largeResult;
+    }
+    // progress: count of values before the first frame that is not finished yet
+    c = (m_largeNext < m_largeEnd) ? m_largeNext : m_largeEnd;
+    for (i = 0, p = this; p; p = pipelineMaster(i++))
+    {
+        if (p->m_largeChunk < c)
+            c = p->m_largeChunk;
+    }
+    done = static_cast<uint32_t>(c)*chunk;
+    if (fact)
+        *fact = (done < count) ? static_cast<uint16_t>(done) : count;
+    return Modbus::PROCESSING;
+}
+
+Modbus::Response ModbusMaster::readData(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t* fact)
+{
+    switch (func)
+    {
+    case MBF_READ_COIL_STATUS:
+    case MBF_READ_INPUT_STATUS:
+    case MBF_READ_HOLDING_REGISTERS:
+    case MBF_READ_INPUT_REGISTERS:
+        return execChunk(func, slave, offset, count, data, 0, fact);
+    default:
+        return Modbus::ILLEGAL_FUNCTION;
+    }
+}
+
+Modbus::Response ModbusMaster::execChunk(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t pos, uint16_t* fact)
+{
+    // frame boundaries of bit transfers are multiple of 8, so bits of frame begin at byte 'pos/8'
+    switch (func)
+    {
+    case MBF_READ_COIL_STATUS:
+        return readCoilStatus(slave, offset, count, reinterpret_cast<uint8_t*>(data)+pos/8, fact);
+    case MBF_READ_INPUT_STATUS:
+        return readInputStatus(slave, offset, count, reinterpret_cast<uint8_t*>(data)+pos/8, fact);
+    case MBF_READ_HOLDING_REGISTERS:
+        return readHoldingRegisters(slave, offset, count, reinterpret_cast<uint16_t*>(data)+pos, fact);
+    case MBF_READ_INPUT_REGISTERS:
+        return readInputRegisters(slave, offset, count, reinterpret_cast<uint16_t*>(data)+pos, fact);
+    case MBF_FORCE_MULTIPLE_COILS:
+        return forceMultipleCoils(slave, offset, count, reinterpret_cast<const uint8_t*>(data)+pos/8, fact);
+    default:
+        return forceMultipleRegisters(slave, offset, count, reinterpret_cast<const uint16_t*>(data)+pos, fact);
+    }
+}
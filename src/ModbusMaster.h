@@ -27,6 +27,40 @@
 #include "Modbus.h"
 
 class Stream;
+class ModbusHealth;
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- MODBUS REQUEST ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+struct ModbusRequest;
+
+typedef void (*ModbusRequestCallback)(ModbusRequest* request);
+
+// Request that is submitted to ModbusMaster queue ('ModbusMaster::submit') and executed by 'ModbusMaster::poll'.
+// Request must not be changed or destroyed while it's in queue (its status is Modbus::PROCESSING).
+// Canceled request gets status Modbus::CMN_ERR_CANCELED.
+struct ModbusRequest
+{
+    uint8_t slave;                  // slave address (it's set to address of responded slave when request is completed)
+    uint8_t func;                   // function: 1-6, 15, 16, 22 or 23
+    uint16_t offset;                // offset of first bit/register (offset to read for FC23)
+    uint16_t count;                 // count of bits/registers (count to read for FC23), frames of 1-4, 15, 16 are split if it's greater than maximum
+    void* data;                     // bits (FC1, FC2, FC5, FC15) or uint16_t values (FC3, FC4, FC6, FC16, values to read for FC23),
+                                    // FC22: uint16_t[2] = {andMask, orMask}
+    uint16_t writeOffset;           // FC23: offset of registers to write
+    uint16_t writeCount;            // FC23: count of registers to write
+    const void* writeData;          // FC23: uint16_t values to write
+    ModbusRequestCallback callback; // called by 'ModbusMaster::poll' when request is completed (can be NULL)
+    void* context;                  // user data for callback
+    Modbus::Response status;        // result (Modbus::PROCESSING - request is in queue, Modbus::CMN_ERR_CANCELED - canceled)
+    uint16_t fact;                  // count of bits/registers transferred
+    uint8_t priority;               // ModbusScheduler: priority class (ModbusScheduler::Priority)
+    unsigned long deadline;         // ModbusScheduler: time (ms) after submission when request must be started (0 - default of class)
+    // used by ModbusMaster and ModbusScheduler
+    unsigned long time;             // time (millis) of submission to ModbusScheduler
+    ModbusRequest* next;
+};
 
 // --------------------------------------------------------------------------------------------------------
 // ------------------------------------------ MODBUS MASTER BASE ------------------------------------------
@@ -67,16 +101,41 @@ public:
     inline Stream* verboseStream() const { return m_verboseStream; }
     inline void setVerboseStream(Stream* stream) { m_verboseStream = stream; }
     inline State state() const { return m_state; }
+    inline ModbusHealth* health() const { return m_health; }
+    inline void setHealth(ModbusHealth* health) { m_health = health; } // NULL - requests are sent to any slave
     
 public: // Modbus Interface
     virtual Modbus::Response readCoilStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response readInputStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response readHoldingRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readHoldingRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response readInputRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readInputRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response forceSingleCoil(uint8_t &slave, uint16_t offset, bool value);
     virtual Modbus::Response forceSingleRegister(uint8_t &slave, uint16_t offset, uint16_t value);
     virtual Modbus::Response forceMultipleCoils(uint8_t &slave, uint16_t offset, uint16_t count, const void* bits, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response forceMultipleRegisters(uint8_t &slave, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response maskWriteRegister(uint8_t &slave, uint16_t offset, uint16_t andMask, uint16_t orMask);
+    virtual Modbus::Response readWriteMultipleRegisters(uint8_t &slave, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readWriteMultipleRegistersBE(uint8_t &slave, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact = MB_NULLPTR);
+
+public: // read function by its code: MBF_READ_COIL_STATUS, MBF_READ_INPUT_STATUS, MBF_READ_HOLDING_REGISTERS or MBF_READ_INPUT_REGISTERS
+    Modbus::Response readData(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t* fact = MB_NULLPTR);
+
+public: // request queue: requests are executed one by one in order of submission by 'poll' that must be called in loop
+    bool submit(ModbusRequest* request);
+    bool cancel(ModbusRequest* request);
+    void poll();
+    inline uint8_t queued() const { return m_queued; }
+    bool isQueued(const ModbusRequest* request) const;
+
+public: // large transfers: split into frames of maximum size by Modbus specification, 'fact' shows progress while PROCESSING
+    Modbus::Response readCoilStatusLarge(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
+    Modbus::Response readInputStatusLarge(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
+    Modbus::Response readHoldingRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    Modbus::Response readInputRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    Modbus::Response forceMultipleCoilsLarge(uint8_t &slave, uint16_t offset, uint16_t count, const void* bits, uint16_t* fact = MB_NULLPTR);
+    Modbus::Response forceMultipleRegistersLarge(uint8_t &slave, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR);
 
 protected: // buffer control interface
     virtual uint16_t bufferSize() const = 0;
@@ -86,9 +145,18 @@ protected: // buffer control interface
     virtual void setBufferByteAt(uint16_t offset, uint8_t value) = 0;
     inline void setBufferByte(uint16_t offset, uint8_t value) { if (offset < bufferSize()) setBufferByteAt(offset, value); }
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count) = 0;
+    virtual uint8_t* bufferData(uint16_t offset) = 0; // direct pointer to buffer bytes started from 'offset'
     
 protected:
     virtual Modbus::Response exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff) = 0;
+    virtual ModbusMaster* pipelineMaster(uint8_t /*i*/) const { return MB_NULLPTR; } // i-th master that can execute frames of large transfer in parallel
+    
+private:
+    Modbus::Response request(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff);
+    Modbus::Response execRequest(ModbusRequest* request);
+    inline bool isIdle() const { return (m_state == STATE_UNKNOWN) || (m_state == STATE_DISCONNECTED) || (m_state == STATE_CONNECTED) || (m_state == STATE_BEGIN_WRITE); }
+    Modbus::Response execLarge(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t* fact);
+    Modbus::Response execChunk(uint8_t func, uint8_t &slave, uint16_t offset, uint16_t count, void* data, uint16_t pos, uint16_t* fact);
     
 protected:
     const char* m_name;
@@ -96,6 +164,23 @@ protected:
     State m_state;
     uint16_t m_memOffset;
     uint16_t m_mem;
+    uint16_t m_memMask;
+    
+private:
+    ModbusHealth* m_health;
+
+private: // request queue
+    ModbusRequest* m_queue;             // first request of queue (it's in process)
+    ModbusRequest* m_queueTail;         // last request of queue
+    uint8_t m_queued;                   // count of requests in queue
+
+private: // large transfer
+    uint16_t m_largeChunk;              // frame of large transfer executed by this master
+    bool m_large;                       // large transfer is in process
+    uint16_t m_largeNext;               // next frame to execute
+    uint16_t m_largeEnd;                // first frame that was not transferred completely
+    uint16_t m_largeEndFact;            // count of values transferred by frame 'm_largeEnd'
+    Modbus::Response m_largeResult;     // result of frame 'm_largeEnd'
 };
 
 #endif // MODBUSMASTER_H
@@ -22,6 +22,8 @@
 */
 
 #include "ModbusMasterRTU.h"
+#include "ModbusRTUTiming.h"
+#include "ModbusAdaptiveTimeout.h"
 
 #include <Arduino.h>
 #include <Stream.h>
@@ -39,12 +41,51 @@ static const uint16_t c_HiLevBuffSzDiff = c_HiLevBuffOffset+sizeof(uint16_t);
 // high level buffer size
 static const uint16_t c_HiLevBuffSz = MB_RTU_IO_BUFF_SZ-c_HiLevBuffSzDiff; 
 
+// Returns size of RTU response frame (with crc) which first 'sz' bytes are in 'buff'
+// or 0 if size is unknown yet (or unknown for this function at all)
+static uint16_t responseSize(const uint8_t* buff, uint16_t sz)
+{
+    if (sz < 2)
+        return 0;
+    if (buff[1] & MBF_EXCEPTION) // slave(1), function(1), exception code(1), crc(2)
+        return 5;
+    switch (buff[1])
+    {
+    case MBF_READ_COIL_STATUS:
+    case MBF_READ_INPUT_STATUS:
+    case MBF_READ_HOLDING_REGISTERS:
+    case MBF_READ_INPUT_REGISTERS:
+    case MBF_READ_WRITE_4X_REGISTER:
+        if (sz < 3)
+            return 0;
+        return 5+buff[2]; // slave(1), function(1), count of bytes(1), data, crc(2)
+    case MBF_FORCE_SINGLE_COIL:
+    case MBF_FORCE_SINGLE_REGISTER:
+    case MBF_FORCE_MULTIPLE_COILS:
+    case MBF_FORCE_MULTIPLE_REGISTERS:
+        return 8; // slave(1), function(1), offset(2), value or count(2), crc(2)
+    case MBF_MASK_WRITE_4X_REGISTER:
+        return 10; // slave(1), function(1), offset(2), and mask(2), or mask(2), crc(2)
+    default:
+        return 0;
+    }
+}
+
 ModbusMasterRTU::ModbusMasterRTU(Stream* stream) :
     ModbusMaster(),
     m_stream(stream)
 {
     m_timeoutFB = 5000;
     m_timeoutIB = 20;
+    m_turnaround = 100;
+    m_timing = MB_NULLPTR;
+    m_adaptive = MB_NULLPTR;
+}
+
+// timeout of first byte of response: learned for current slave if adaptive timeout is set, otherwise 'timeoutFirstByte'
+unsigned long ModbusMasterRTU::firstByteTimeout() const
+{
+    return m_adaptive ? m_adaptive->timeout(m_slave) : m_timeoutFB;
 }
 
 uint16_t ModbusMasterRTU::bufferSize() const
@@ -72,9 +113,14 @@ void ModbusMasterRTU::setBufferBytesAt(uint16_t offset, const void *buff, uint16
     memcpy(&m_buff[c_HiLevBuffOffset+offset], buff, count);
 }
 
+uint8_t* ModbusMasterRTU::bufferData(uint16_t offset)
+{
+    return &m_buff[c_HiLevBuffOffset+offset];
+}
+
 Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff)
 {
-    uint16_t crc;
+    uint16_t crc, c;
     bool fRepeatAgain;
 
     do
@@ -118,11 +164,39 @@ Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t sz
                 m_verboseStream->print("Tx: ");
                 Modbus::printBytes(m_verboseStream, m_buff, m_sz);
             }
+            // turnaround delay of broadcast begins when frame is sent out completely
+            if (Modbus::isBroadcast(m_slave, m_func))
+                m_stream->flush();
             m_start = millis();
             // go to the read first bytes state
             m_state = STATE_WAIT_FOR_READ;
             break;
         case STATE_WAIT_FOR_READ:
+            if (Modbus::isBroadcast(m_slave, m_func))
+            {
+                // nobody responds to broadcast: bus is free after turnaround delay
+                while (m_stream->available())
+                    m_stream->read();
+                if (millis()-m_start < m_turnaround)
+                    break;
+                // make response as if slave responded to request that is still in buffer
+                switch (m_func)
+                {
+                case MBF_FORCE_MULTIPLE_COILS:
+                case MBF_FORCE_MULTIPLE_REGISTERS:
+                    *szOutBuff = 4; // offset and count of written values
+                    break;
+                case MBF_READ_WRITE_4X_REGISTER:
+                    m_buff[c_HiLevBuffOffset] = 0; // nothing is read
+                    *szOutBuff = 1;
+                    break;
+                default:
+                    *szOutBuff = m_sz - c_HiLevBuffSzDiff; // echo of request
+                    break;
+                }
+                m_state = STATE_BEGIN_WRITE;
+                return Modbus::OK;
+            }
             // read first byte state
             if (m_stream->available()) // first byte read
             {
@@ -137,11 +211,21 @@ Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t sz
                     m_state = STATE_BEGIN_WRITE;
                     return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
                 }
-                m_start = millis();
+                if (m_adaptive)
+                    m_adaptive->sample(m_slave, millis()-m_start);
+                m_crc = Modbus::crc16_update(MB_CRC16_INIT, m_buff, m_sz); // rolling crc of received bytes
+                m_start = ModbusRTUTiming::lineTime(m_timing);
                 m_state = STATE_WAIT_FOR_READ_ALL;
+                if ((m_sz == responseSize(m_buff, m_sz)) && !m_crc) // whole frame is received - no need to wait for silence
+                {
+                    m_state = STATE_READ;
+                    fRepeatAgain = true;
+                }
             }
-            else if (millis()-m_start >= m_timeoutFB) // waiting timeout read first byte elapsed
+            else if (millis()-m_start >= firstByteTimeout()) // waiting timeout read first byte elapsed
             {
+                if (m_adaptive)
+                    m_adaptive->expired(m_slave);
                 m_state = STATE_BEGIN_WRITE;
                 return Modbus::SERIAL_ERR_READ;
             }
@@ -150,7 +234,7 @@ Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t sz
             // read all bytes state until interbyte timeout elapsed
             if (m_stream->available())
             {
-                for (; m_stream->available() && (m_sz < MB_RTU_IO_BUFF_SZ); m_sz++)
+                for (c = m_sz; m_stream->available() && (m_sz < MB_RTU_IO_BUFF_SZ); m_sz++)
                     m_buff[m_sz] = m_stream->read();
                 if ((m_sz >= MB_RTU_IO_BUFF_SZ) && m_stream->available())
                 {
@@ -161,9 +245,15 @@ Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t sz
                     m_state = STATE_BEGIN_WRITE;
                     return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
                 }
-                m_start = millis();
+                m_crc = Modbus::crc16_update(m_crc, &m_buff[c], m_sz-c); // fold new bytes into rolling crc
+                m_start = ModbusRTUTiming::lineTime(m_timing);
+                if ((m_sz == responseSize(m_buff, m_sz)) && !m_crc) // whole frame is received - no need to wait for silence
+                {
+                    m_state = STATE_READ;
+                    fRepeatAgain = true;
+                }
             }
-            else if (millis()-m_start >= m_timeoutIB) // waiting timeout elapsed - means that all data read
+            else if (ModbusRTUTiming::isLineSilent(m_timing, m_start, m_timeoutIB)) // waiting timeout elapsed - means that all data read (frame size is unknown or crc is wrong)
             {
                 m_state = STATE_READ;
                 fRepeatAgain = true;
@@ -186,8 +276,7 @@ Modbus::Response ModbusMasterRTU::exec(uint8_t &slave, uint8_t func, uint16_t sz
             if (m_sz < 5)
                 return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Responsed data length to small
         
-            crc = m_buff[m_sz-2] | (m_buff[m_sz-1] << 8);
-            if (Modbus::crc16(m_buff, m_sz-2) != crc)
+            if (m_crc) // crc of whole frame including its own crc-bytes must be zero
                 return Modbus::RTU_ERR_CRC; // Wrong CRC
         
             if (m_slave && (m_buff[0] != m_slave))
@@ -26,6 +26,9 @@
 
 #include "ModbusMaster.h"
 
+class ModbusRTUTiming;
+class ModbusAdaptiveTimeout;
+
 // --------------------------------------------------------------------------------------------------------
 // ------------------------------------------- MODBUS MASTER RTU ------------------------------------------
 // --------------------------------------------------------------------------------------------------------
@@ -45,6 +48,12 @@ public:
     inline void setTimeoutFirstByte(unsigned long timeout) { m_timeoutFB = timeout; }
     inline unsigned long timeoutInterByte() const { return m_timeoutIB; }
     inline void setTimeoutInterByte(unsigned long timeout) { m_timeoutIB = timeout; }
+    inline unsigned long turnaroundDelay() const { return m_turnaround; }
+    inline void setTurnaroundDelay(unsigned long delay) { m_turnaround = delay; }
+    inline const ModbusRTUTiming* timing() const { return m_timing; }
+    inline void setTiming(const ModbusRTUTiming* timing) { m_timing = timing; } // NULL - use 'timeoutInterByte'
+    inline ModbusAdaptiveTimeout* adaptiveTimeout() const { return m_adaptive; }
+    inline void setAdaptiveTimeout(ModbusAdaptiveTimeout* adaptive) { m_adaptive = adaptive; } // NULL - use 'timeoutFirstByte'
 
 protected: // buffer control interface
     virtual uint16_t bufferSize() const;
@@ -52,19 +61,27 @@ protected: // buffer control interface
     virtual void getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const;
     virtual void setBufferByteAt(uint16_t offset, uint8_t value);
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count);
+    virtual uint8_t* bufferData(uint16_t offset);
         
 protected:
     virtual Modbus::Response exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff);
     
+private:
+    unsigned long firstByteTimeout() const;
+
 private:
     Stream* m_stream;
     unsigned long m_timeoutFB;
     unsigned long m_timeoutIB;
+    unsigned long m_turnaround;
+    const ModbusRTUTiming* m_timing;
+    ModbusAdaptiveTimeout* m_adaptive;
     unsigned long m_start;
     uint8_t m_slave;
     uint8_t m_func;
     uint8_t m_buff[MB_RTU_IO_BUFF_SZ];
     uint16_t m_sz;
+    uint16_t m_crc;
 };
 
 #endif // MODBUSMASTERRTU_H
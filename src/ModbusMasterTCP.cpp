@@ -22,6 +22,9 @@
 */
 
 #include "ModbusMasterTCP.h"
+#include "ModbusMasterTCPPool.h"
+#include "ModbusMasterTCPChannel.h"
+#include "ModbusAdaptiveTimeout.h"
 
 #include <string.h>
 #include <limits.h>
@@ -55,11 +58,25 @@ ModbusMasterTCP::ModbusMasterTCP(const char* host, uint16_t port) : ModbusMaster
     m_port = port;
     m_transaction = 0;
     m_timeout = 5000;
+    m_adaptive = MB_NULLPTR;
     m_sock = MAX_SOCK_NUM;
     m_state = STATE_UNKNOWN;
     m_start = 0;
     m_sz = 0;
     m_block = false;
+    m_window = MODBUS_MASTER_TCP_WINDOW;
+    m_outstanding = 0;
+    m_own.buff = m_buff;
+    m_own.sz = 0;
+    m_own.wait = false;
+    m_own.next = MB_NULLPTR;
+    m_pending = MB_NULLPTR;
+    m_rxBuff = MB_NULLPTR;
+    m_rxPending = MB_NULLPTR;
+    m_rxPos = 0;
+    m_rxLen = 0;
+    m_pool = MB_NULLPTR;
+    m_channels = MB_NULLPTR;
     if (!m_ip.fromString(host))
     {
         DNSClient dns;
@@ -68,10 +85,31 @@ ModbusMasterTCP::ModbusMasterTCP(const char* host, uint16_t port) : ModbusMaster
     }
 }
 
+uint8_t ModbusMasterTCP::openSocket(uint32_t ip, uint16_t port)
+{
+    uint8_t sock;
+
+    for (sock = 0; sock < MAX_SOCK_NUM; sock++)
+    {
+        if (socketStatus(sock) == SnSR::CLOSED)
+            break;
+    }
+    if (sock == MAX_SOCK_NUM)
+        return MAX_SOCK_NUM;
+
+    s_srcport++;
+    if (s_srcport > CLIENT_PORT_MAX)
+        s_srcport = CLIENT_PORT_MIN;          //Use IANA recommended ephemeral port range 49152-65535
+    socket(sock, SnMR::TCP, s_srcport, 0);
+    
+    ::connect(sock, reinterpret_cast<uint8_t*>(&ip), port);
+    return sock;
+}
+
 Modbus::Response ModbusMasterTCP::connect()
 {
+    Modbus::Response r;
     uint8_t s;
-    uint32_t ip;
     bool fRepeatAgain;
     
     do
@@ -86,27 +124,31 @@ Modbus::Response ModbusMasterTCP::connect()
                 return Modbus::OK;
             }
 
-            for (int i = 0; i < MAX_SOCK_NUM; i++)
+            if (m_pool) // borrow connection from pool
             {
-                s = socketStatus(i);
-                if (s == SnSR::CLOSED)
-                {
-                    m_sock = i;
-                    break;
-                }
+                m_sock = MAX_SOCK_NUM;
+                r = m_pool->acquire(this, m_sock);
+                if (r != Modbus::OK)
+                    return r;
+                // requests of previous connection will never be responsed
+                while (m_pending)
+                    cancelPending(m_pending);
+                m_rxPos = 0;
+                m_state = STATE_CONNECTED;
+                return Modbus::OK;
             }
+
+            if (m_sock != MAX_SOCK_NUM) // release socket of dropped connection
+                close(m_sock);
+            m_sock = openSocket((uint32_t)m_ip, m_port);
             if (m_sock == MAX_SOCK_NUM)
             {
                 return Modbus::TCP_ERR_CONNECT;
             }
-
-            s_srcport++;
-            if (s_srcport > CLIENT_PORT_MAX)
-                s_srcport = CLIENT_PORT_MIN;          //Use IANA recommended ephemeral port range 49152-65535
-            socket(m_sock, SnMR::TCP, s_srcport, 0);
-            
-            ip = (uint32_t)m_ip;
-            ::connect(m_sock, reinterpret_cast<uint8_t*>(&ip), m_port);
+            // requests of previous connection will never be responsed
+            while (m_pending)
+                cancelPending(m_pending);
+            m_rxPos = 0;
             m_start = millis();
             m_state = STATE_WAIT_FOR_CONNECT;
             fRepeatAgain = true;
@@ -148,6 +190,14 @@ Modbus::Response ModbusMasterTCP::disconnect()
     if (m_sock == MAX_SOCK_NUM)
         return Modbus::OK;
     
+    if (m_pool) // connection is closed by pool and will be reopened in background
+    {
+        m_pool->drop(this);
+        m_sock = MAX_SOCK_NUM;
+        m_state = STATE_DISCONNECTED;
+        return Modbus::OK;
+    }
+    
     do
     {
         fRepeatAgain = false;
@@ -165,12 +215,14 @@ Modbus::Response ModbusMasterTCP::disconnect()
             s = socketStatus(m_sock);
             if (s == SnSR::CLOSED)
             {
+                m_sock = MAX_SOCK_NUM;
                 m_state = STATE_DISCONNECTED;
                 return Modbus::OK;   
             }
             else if (millis()-m_start >= m_timeout)
             {
                 close(m_sock);
+                m_sock = MAX_SOCK_NUM;
                 m_state = STATE_DISCONNECTED;
                 return Modbus::TCP_ERR_DISCONNECT;
             }
@@ -226,6 +278,11 @@ void ModbusMasterTCP::setBufferBytesAt(uint16_t offset, const void *buff, uint16
     memcpy(&m_buff[c_HiLevBuffOffset+offset], buff, count);
 }
 
+uint8_t* ModbusMasterTCP::bufferData(uint16_t offset)
+{
+    return &m_buff[c_HiLevBuffOffset+offset];
+}
+
 Modbus::Response ModbusMasterTCP::exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff)
 {    
     int r;
@@ -269,6 +326,11 @@ Modbus::Response ModbusMasterTCP::exec(uint8_t &slave, uint8_t func, uint16_t sz
                     return r;
                 }
             }
+            if (isWindowFull()) // wait until one of pipelined requests is finished
+            {
+                receive();
+                return Modbus::PROCESSING;
+            }
             r = write();
             if (m_verboseStream)
             {
@@ -288,23 +350,24 @@ Modbus::Response ModbusMasterTCP::exec(uint8_t &slave, uint8_t func, uint16_t sz
             m_state = STATE_WAIT_FOR_WRITE;
             // no need break
         case STATE_WAIT_FOR_WRITE:
-            m_start = millis();
+            post(&m_own);
             m_state = STATE_WAIT_FOR_READ;
             fRepeatAgain = true;
             break;
         case STATE_WAIT_FOR_READ:
             // receive data from server
-            if (available())
+            receive();
+            if (m_own.sz) // response with transaction id of request is received
             {
-                for (m_sz = 0; available() && (m_sz < MB_TCP_IO_BUFF_SZ); m_sz++)
-                    m_buff[m_sz] = read();
-                if ((m_sz >= MB_TCP_IO_BUFF_SZ) && available())
+                if (m_adaptive)
+                    m_adaptive->sample(m_slave, millis()-m_own.start);
+                m_sz = m_own.sz;
+                m_own.sz = 0;
+                if (m_sz > MB_TCP_IO_BUFF_SZ)
                 {
-                    // clean read buffer
-                    while (read() == -1)
-                        ;
-                    // and jump to STATE_BEGIN_WRITE
+                    // jump to STATE_BEGIN_WRITE
                     m_state = STATE_BEGIN_WRITE;
+                    deblockBuffer();
                     return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
                 }
                 if (m_verboseStream)
@@ -318,11 +381,24 @@ Modbus::Response ModbusMasterTCP::exec(uint8_t &slave, uint8_t func, uint16_t sz
                     Modbus::printBytes(m_verboseStream, m_buff, m_sz);
                 }
                 m_state = STATE_BEGIN_WRITE;
+                releaseConnection();
                 return readBuffer(slave, szOutBuff);
             }
-            else if (millis()-m_start >= m_timeout)
+            else if (!m_own.wait) // connection was reopened and request is lost
             {
-                disconnect();
+                m_state = STATE_BEGIN_WRITE;
+                deblockBuffer(); // mark the buffer is free to store new data
+                return Modbus::TCP_ERR_RECV;
+            }
+            else if (millis()-m_own.start >= responseTimeout(m_slave))
+            {
+                if (m_adaptive)
+                    m_adaptive->expired(m_slave);
+                cancelPending(&m_own);
+                if (m_outstanding) // other requests are in process, late response will be skipped by transaction id
+                    m_state = STATE_BEGIN_WRITE;
+                else
+                    disconnect();
                 deblockBuffer(); // mark the buffer is free to store new data
                 return Modbus::TCP_ERR_RECV;
             }
@@ -340,6 +416,19 @@ Modbus::Response ModbusMasterTCP::exec(uint8_t &slave, uint8_t func, uint16_t sz
     return Modbus::PROCESSING;
 }
 
+ModbusMaster* ModbusMasterTCP::pipelineMaster(uint8_t i) const
+{
+    ModbusMasterTCPChannel* ch;
+    
+    // only channels given to large transfers
+    for (ch = m_channels; ch; ch = ch->m_nextChannel)
+    {
+        if (ch->m_pipelineEnabled && !i--)
+            break;
+    }
+    return ch;
+}
+
 Modbus::Response ModbusMasterTCP::writeBuffer(uint8_t slave, uint8_t func, uint16_t szInBuff)
 {
     if (m_block)
@@ -367,50 +456,201 @@ Modbus::Response ModbusMasterTCP::writeBuffer(uint8_t slave, uint8_t func, uint1
 
 Modbus::Response ModbusMasterTCP::readBuffer(uint8_t &slave, uint16_t* szOutBuff)
 {
-    uint16_t transaction;
-    
     m_block = false;
-    if (m_sz < 9) // minimum size of message 9 = 6 byte(tcp-prefix)+1 byte(slave)+1 byte(func)+1 byte(data-may be err code)
+    return checkResponse(m_buff, m_sz, m_own.transaction, m_slave, m_func, slave, szOutBuff);
+}
+
+Modbus::Response ModbusMasterTCP::write()
+{
+    return sendFrame(m_buff, m_sz);
+}
+
+int ModbusMasterTCP::available() const
+{
+    if (m_sock != MAX_SOCK_NUM)
+        return recvAvailable(m_sock);
+    return 0;
+}
+
+int ModbusMasterTCP::read()
+{
+    uint8_t b;
+    if (recv(m_sock, &b, 1) > 0)
+        return b;
+    return -1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- PIPELINING -----------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+Modbus::Response ModbusMasterTCP::checkResponse(const uint8_t* buff, uint16_t sz, uint16_t transaction, uint8_t reqSlave, uint8_t func, uint8_t &slave, uint16_t* szOutBuff)
+{
+    if (sz < 9) // minimum size of message 9 = 6 byte(tcp-prefix)+1 byte(slave)+1 byte(func)+1 byte(data-may be err code)
         return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Responsed data length to small
 
-    transaction = m_buff[1] | (m_buff[0]<<8);
-    if (!((m_transaction == transaction) && (m_buff[2] == 0) && (m_buff[3] == 0) && (m_buff[4] == 0)))
+    if (!((transaction == (buff[1] | (buff[0]<<8))) && (buff[2] == 0) && (buff[3] == 0) && (buff[4] == 0)))
         return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Request header is not equal to response header
 
-    if ((m_buff[7] & MBF_EXCEPTION) == MBF_EXCEPTION)
-        return m_buff[8] ? m_buff[8] : Modbus::UNKNOWN_ERROR; // Returned modbus exception
+    if ((buff[7] & MBF_EXCEPTION) == MBF_EXCEPTION)
+        return buff[8] ? buff[8] : Modbus::UNKNOWN_ERROR; // Returned modbus exception
 
-    if (m_slave && (m_buff[6] != m_slave))
+    if (reqSlave && (buff[6] != reqSlave))
         return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Requested unit (slave) is not equal to responsed
-    slave = m_buff[6];
+    slave = buff[6];
     
-    if (m_buff[7] != m_func)
+    if (buff[7] != func)
         return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Requested function is not equal to responsed
 
-    *szOutBuff = m_sz - c_HiLevBuffSzDiff;
+    *szOutBuff = sz - c_HiLevBuffSzDiff;
     return Modbus::OK;
 }
 
-Modbus::Response ModbusMasterTCP::write()
+Modbus::Response ModbusMasterTCP::sendFrame(const uint8_t* buff, uint16_t sz)
 {
     if (m_sock == MAX_SOCK_NUM)
         return Modbus::TCP_ERR_SEND;
-    if (!send(m_sock, m_buff, m_sz))
+    if (!send(m_sock, buff, sz))
         return Modbus::TCP_ERR_SEND;
     return Modbus::OK;
 }
 
-int ModbusMasterTCP::available() const
+void ModbusMasterTCP::releaseConnection()
 {
-    if (m_sock != MAX_SOCK_NUM)
-        return recvAvailable(m_sock);
-    return 0;
+    if (m_pool && !m_outstanding && !m_rxPos && (m_sock != MAX_SOCK_NUM))
+    {
+        m_pool->release(this);
+        m_sock = MAX_SOCK_NUM;
+        m_state = STATE_DISCONNECTED;
+    }
 }
 
-int ModbusMasterTCP::read()
+// response timeout of request to 'slave': learned if adaptive timeout is set, otherwise 'timeout'
+unsigned long ModbusMasterTCP::responseTimeout(uint8_t slave) const
 {
-    uint8_t b;
-    if (recv(m_sock, &b, 1) > 0)
-        return b;
-    return -1;
+    return m_adaptive ? m_adaptive->timeout(slave) : m_timeout;
+}
+
+void ModbusMasterTCP::post(Pending* p)
+{
+    p->transaction = p->buff[1] | (p->buff[0]<<8);
+    p->sz = 0;
+    p->start = millis();
+    p->wait = true;
+    p->next = m_pending;
+    m_pending = p;
+    m_outstanding++;
+}
+
+void ModbusMasterTCP::cancelPending(Pending* p)
+{
+    Pending** pp;
+    
+    if (!p->wait)
+        return;
+    for (pp = &m_pending; *pp; pp = &(*pp)->next)
+    {
+        if (*pp == p)
+        {
+            *pp = p->next;
+            break;
+        }
+    }
+    if (m_rxPending == p) // rest of incoming frame will be skipped
+    {
+        m_rxPending = MB_NULLPTR;
+        m_rxBuff = MB_NULLPTR;
+    }
+    p->wait = false;
+    m_outstanding--;
+}
+
+// Closes connection with garbage in incoming stream, every pending request is lost
+void ModbusMasterTCP::abortConnection()
+{
+    while (m_pending)
+        cancelPending(m_pending);
+    m_rxPos = 0;
+    if (m_pool) // connection is reopened by pool in background
+        m_pool->drop(this);
+    else
+        close(m_sock);
+    m_sock = MAX_SOCK_NUM;
+}
+
+void ModbusMasterTCP::receive()
+{
+    uint8_t skip[16];
+    Pending* p;
+    uint16_t transaction, len;
+    int16_t c, n;
+
+    while ((c = available()) > 0)
+    {
+        if (m_rxPos < sizeof(m_rxHead))
+        {
+            // read MBAP header of incoming frame
+            n = sizeof(m_rxHead)-m_rxPos;
+            if (c < n)
+                n = c;
+            n = recv(m_sock, &m_rxHead[m_rxPos], n);
+            if (n <= 0)
+                break;
+            m_rxPos += n;
+            if (m_rxPos < sizeof(m_rxHead))
+                continue;
+            // MBAP header: protocol id is 0, length is unit id and PDU (function and up to 252 bytes of data)
+            len = m_rxHead[5] | (m_rxHead[4]<<8);
+            if (m_rxHead[2] || m_rxHead[3] || (len < 2) || (len > 254))
+            {
+                // stream of frames can't be resynchronized
+                abortConnection();
+                break;
+            }
+            m_rxLen = len+sizeof(m_rxHead); // frame is not longer than 260 bytes, so 'n' never overflows
+            // find request with the same transaction id
+            transaction = m_rxHead[1] | (m_rxHead[0]<<8);
+            for (p = m_pending; p; p = p->next)
+            {
+                if (p->transaction == transaction)
+                    break;
+            }
+            m_rxPending = p;
+            m_rxBuff = p ? p->buff : MB_NULLPTR; // unknown (e.g. late) response is skipped
+            if (m_rxBuff)
+                memcpy(m_rxBuff, m_rxHead, sizeof(m_rxHead));
+        }
+        else
+        {
+            // read data of incoming frame
+            n = m_rxLen-m_rxPos;
+            if (c < n)
+                n = c;
+            if (m_rxBuff && (m_rxPos < MB_TCP_IO_BUFF_SZ))
+            {
+                if (n > MB_TCP_IO_BUFF_SZ-m_rxPos)
+                    n = MB_TCP_IO_BUFF_SZ-m_rxPos;
+                n = recv(m_sock, &m_rxBuff[m_rxPos], n);
+            }
+            else
+            {
+                if (n > static_cast<int16_t>(sizeof(skip)))
+                    n = sizeof(skip);
+                n = recv(m_sock, skip, n);
+            }
+            if (n <= 0)
+                break;
+            m_rxPos += n;
+        }
+        if (m_rxPos >= m_rxLen) // whole frame is received
+        {
+            p = m_rxPending;
+            if (p)
+            {
+                cancelPending(p);
+                p->sz = m_rxLen; // size greater than buffer size means overflow
+            }
+            m_rxPos = 0;
+        }
+    }
 }
@@ -28,12 +28,24 @@
 
 #include "ModbusMaster.h"
 
+// default maximum count of requests that can be sent to server without waiting of response (pipelining)
+#ifndef MODBUS_MASTER_TCP_WINDOW
+#define MODBUS_MASTER_TCP_WINDOW 4
+#endif
+
+class ModbusMasterTCPChannel;
+class ModbusMasterTCPPool;
+class ModbusAdaptiveTimeout;
+
 // --------------------------------------------------------------------------------------------------------
 // ------------------------------------------ MODBUS MASTER TCP -------------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
 class ModbusMasterTCP : public ModbusMaster
 {
+    friend class ModbusMasterTCPChannel;
+    friend class ModbusMasterTCPPool;
+    
 public:
     ModbusMasterTCP(const char* host, uint16_t port = Modbus::STANDARD_TCP_PORT);
     
@@ -46,6 +58,13 @@ public:
     bool isConnected() const;
     inline unsigned long timeout() const { return m_timeout; }
     inline void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+    inline ModbusAdaptiveTimeout* adaptiveTimeout() const { return m_adaptive; }
+    inline void setAdaptiveTimeout(ModbusAdaptiveTimeout* adaptive) { m_adaptive = adaptive; } // NULL - use 'timeout'
+    inline uint8_t window() const { return m_window; }
+    inline void setWindow(uint8_t window) { m_window = window ? window : 1; }
+    inline uint8_t outstanding() const { return m_outstanding; }
+    inline ModbusMasterTCPPool* pool() const { return m_pool; }
+    inline void setPool(ModbusMasterTCPPool* pool) { m_pool = pool; }
 
 protected: // buffer control interface
     virtual uint16_t bufferSize() const;
@@ -53,11 +72,26 @@ protected: // buffer control interface
     virtual void getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const;
     virtual void setBufferByteAt(uint16_t offset, uint8_t value);
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count);
+    virtual uint8_t* bufferData(uint16_t offset);
         
 protected:
     virtual Modbus::Response exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff);
+    virtual ModbusMaster* pipelineMaster(uint8_t i) const;
 
 private:
+    // Request that was sent to server and waits for response with the same transaction id
+    struct Pending
+    {
+        uint8_t* buff;          // buffer to store response
+        uint16_t transaction;   // transaction id of request
+        uint16_t sz;            // size of received response (0 - response is not received yet)
+        unsigned long start;    // time when request was sent
+        bool wait;              // request is in list of pending requests
+        Pending* next;
+    };
+
+private:
+    static uint8_t openSocket(uint32_t ip, uint16_t port);
     inline void deblockBuffer() { m_block = false; }
     Modbus::Response writeBuffer(uint8_t slave, uint8_t func, uint16_t szInBuff);
     Modbus::Response readBuffer(uint8_t &slave, uint16_t* szOutBuff);
@@ -65,6 +99,18 @@ private:
     int available() const;
     int read();
 
+private: // pipelining
+    static Modbus::Response checkResponse(const uint8_t* buff, uint16_t sz, uint16_t transaction, uint8_t reqSlave, uint8_t func, uint8_t &slave, uint16_t* szOutBuff);
+    inline bool isWindowFull() const { return m_outstanding >= m_window; }
+    inline uint16_t nextTransaction() { return ++m_transaction; }
+    Modbus::Response sendFrame(const uint8_t* buff, uint16_t sz);
+    void post(Pending* p);
+    void cancelPending(Pending* p);
+    void receive();
+    void abortConnection();
+    void releaseConnection();
+    unsigned long responseTimeout(uint8_t slave) const;
+
 private:
     static uint16_t s_srcport;
     uint8_t m_sock;
@@ -72,12 +118,24 @@ private:
     uint16_t m_port;
     uint16_t m_transaction;
     unsigned long m_timeout;
+    ModbusAdaptiveTimeout* m_adaptive;
     unsigned long m_start;
     uint8_t m_slave;
     uint8_t m_func;
     uint8_t m_buff[MB_TCP_IO_BUFF_SZ];
     uint16_t m_sz;
     bool m_block;
+    uint8_t m_window;
+    uint8_t m_outstanding;
+    Pending m_own;              // own (not channel) pending request
+    Pending* m_pending;         // list of all pending requests of current connection
+    uint8_t m_rxHead[6];        // MBAP header of incoming frame
+    uint8_t* m_rxBuff;          // destination of incoming frame (MB_NULLPTR - frame is skipped)
+    Pending* m_rxPending;       // owner of incoming frame
+    uint16_t m_rxPos;           // count of bytes of incoming frame already received
+    uint16_t m_rxLen;           // full size of incoming frame
+    ModbusMasterTCPPool* m_pool;
+    ModbusMasterTCPChannel* m_channels; // list of channels of this master
 };
 
 #endif // MODBUSMASTERTCP_H
@@ -0,0 +1,214 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusMasterTCPChannel.h"
+#include "ModbusAdaptiveTimeout.h"
+
+#include <string.h>
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------- MODBUS MASTER TCP CHANNEL --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// shift for high-level function (e.g. readCoilStatus etc) = 6 bytes(tcp-prefix)+1 byte(slave)+1 byte(function)
+static const uint16_t c_HiLevBuffOffset = 8;
+
+// high level buffer size
+static const uint16_t c_HiLevBuffSz = MB_TCP_IO_BUFF_SZ-c_HiLevBuffOffset; 
+
+ModbusMasterTCPChannel::ModbusMasterTCPChannel(ModbusMasterTCP* master) : ModbusMaster()
+{
+    m_master = master;
+    m_pending.buff = m_buff;
+    m_pending.sz = 0;
+    m_pending.wait = false;
+    m_pending.next = MB_NULLPTR;
+    m_slave = 0;
+    m_func = 0;
+    m_sz = 0;
+    m_pipelineEnabled = false;
+    m_nextChannel = master->m_channels;
+    master->m_channels = this;
+}
+
+ModbusMasterTCPChannel::~ModbusMasterTCPChannel()
+{
+    ModbusMasterTCPChannel** pp;
+    
+    m_master->cancelPending(&m_pending);
+    for (pp = &m_master->m_channels; *pp; pp = &(*pp)->m_nextChannel)
+    {
+        if (*pp == this)
+        {
+            *pp = m_nextChannel;
+            break;
+        }
+    }
+}
+
+uint16_t ModbusMasterTCPChannel::bufferSize() const
+{
+    return MB_TCP_IO_BUFF_SZ;
+}
+
+uint8_t ModbusMasterTCPChannel::bufferByteAt(uint16_t offset) const
+{
+    return m_buff[c_HiLevBuffOffset+offset];
+}
+
+void ModbusMasterTCPChannel::getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const
+{
+    memcpy(buff, &m_buff[c_HiLevBuffOffset+offset], count);
+}
+
+void ModbusMasterTCPChannel::setBufferByteAt(uint16_t offset, uint8_t value)
+{
+    m_buff[c_HiLevBuffOffset+offset] = value;
+}
+
+void ModbusMasterTCPChannel::setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count)
+{
+    memcpy(&m_buff[c_HiLevBuffOffset+offset], buff, count);
+}
+
+uint8_t* ModbusMasterTCPChannel::bufferData(uint16_t offset)
+{
+    return &m_buff[c_HiLevBuffOffset+offset];
+}
+
+Modbus::Response ModbusMasterTCPChannel::exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff)
+{
+    Modbus::Response r;
+    uint16_t transaction;
+    bool fRepeatAgain;
+    
+    do
+    {
+        fRepeatAgain = false;
+        switch (m_state)
+        {
+        case STATE_WRITE:
+            // make request frame except transaction id which is set just before sending
+            if (szInBuff > c_HiLevBuffSz)
+            {
+                m_state = STATE_BEGIN_WRITE;
+                return Modbus::CMN_ERR_WRITE_BUFF_OVERFLOW;
+            }
+            m_slave = slave;
+            m_func = func;
+            m_buff[2] = 0;
+            m_buff[3] = 0;
+            m_buff[4] = 0;
+            m_buff[5] = static_cast<uint8_t>(szInBuff + 2); // quantity of next bytes
+            m_buff[6] = slave;
+            m_buff[7] = func;
+            m_sz = szInBuff + c_HiLevBuffOffset;
+            m_state = STATE_WAIT_FOR_WRITE;
+            // no need break
+        case STATE_WAIT_FOR_WRITE:
+            // wait for connection and free place in window of master
+            r = m_master->connect();
+            if (r != Modbus::OK) // if not OK it's mean that an error occured or in process
+            {
+                if (r > Modbus::OK) // an error occured
+                    m_state = STATE_BEGIN_WRITE;
+                return r;
+            }
+            if (m_master->isWindowFull())
+            {
+                m_master->receive();
+                return Modbus::PROCESSING;
+            }
+            transaction = m_master->nextTransaction();
+            m_buff[0] = static_cast<uint8_t>(transaction >> 8);  // transaction id
+            m_buff[1] = static_cast<uint8_t>(transaction);       // transaction id
+            r = m_master->sendFrame(m_buff, m_sz);
+            if (m_verboseStream)
+            {
+                if (m_name)
+                {
+                    m_verboseStream->print(m_name);
+                    m_verboseStream->print(' ');
+                }
+                m_verboseStream->print("Tx: ");
+                Modbus::printBytes(m_verboseStream, m_buff, m_sz);
+            }
+            if (r != Modbus::OK)
+            {
+                m_state = STATE_BEGIN_WRITE;
+                return r;
+            }
+            m_master->post(&m_pending);
+            m_state = STATE_WAIT_FOR_READ;
+            // no need break
+        case STATE_WAIT_FOR_READ:
+            // receive all available responses of master connection
+            m_master->receive();
+            if (m_pending.sz) // response with transaction id of request is received
+            {
+                if (m_master->m_adaptive)
+                    m_master->m_adaptive->sample(m_slave, millis()-m_pending.start);
+                m_sz = m_pending.sz;
+                m_pending.sz = 0;
+                m_state = STATE_BEGIN_WRITE;
+                if (m_sz > MB_TCP_IO_BUFF_SZ)
+                    return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
+                if (m_verboseStream)
+                {
+                    if (m_name)
+                    {
+                        m_verboseStream->print(m_name);
+                        m_verboseStream->print(' ');
+                    }
+                    m_verboseStream->print("Rx: ");
+                    Modbus::printBytes(m_verboseStream, m_buff, m_sz);
+                }
+                m_master->releaseConnection();
+                return ModbusMasterTCP::checkResponse(m_buff, m_sz, m_pending.transaction, m_slave, m_func, slave, szOutBuff);
+            }
+            else if (!m_pending.wait) // connection was reopened and request is lost
+            {
+                m_state = STATE_BEGIN_WRITE;
+                return Modbus::TCP_ERR_RECV;
+            }
+            else if (millis()-m_pending.start >= m_master->responseTimeout(m_slave))
+            {
+                if (m_master->m_adaptive)
+                    m_master->m_adaptive->expired(m_slave);
+                // late response will be skipped by transaction id
+                m_master->cancelPending(&m_pending);
+                m_state = STATE_BEGIN_WRITE;
+                return Modbus::TCP_ERR_RECV;
+            }
+            break;
+        default:
+            m_state = STATE_WRITE;
+            fRepeatAgain = true;
+            break;
+        }
+    }
+    while (fRepeatAgain);
+    return Modbus::PROCESSING;
+}
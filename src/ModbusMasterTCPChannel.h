@@ -0,0 +1,77 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSMASTERTCPCHANNEL_H
+#define MODBUSMASTERTCPCHANNEL_H
+
+#include "ModbusMasterTCP.h"
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------- MODBUS MASTER TCP CHANNEL --------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Makes requests through the connection of ModbusMasterTCP without waiting for responses of other requests
+// (pipelining). Each channel has its own buffer and can have one outstanding request, so several channels of
+// the same master keep up to 'ModbusMasterTCP::window()' requests in flight. Responses are matched to requests
+// by MBAP transaction id. Large transfers of master (e.g. 'readHoldingRegistersLarge') also use idle channels
+// with 'setPipelineEnabled(true)' (disabled by default): such channel must not be used by application itself,
+// otherwise its request can get response of frame of large transfer and vice versa.
+class ModbusMasterTCPChannel : public ModbusMaster
+{
+    friend class ModbusMasterTCP;
+    
+public:
+    ModbusMasterTCPChannel(ModbusMasterTCP* master);
+    ~ModbusMasterTCPChannel();
+    
+public:
+     virtual Modbus::Type type() const { return Modbus::TCP; }
+     
+public:
+    inline ModbusMasterTCP* master() const { return m_master; }
+    inline bool isPipelineEnabled() const { return m_pipelineEnabled; }
+    inline void setPipelineEnabled(bool enable) { m_pipelineEnabled = enable; }
+
+protected: // buffer control interface
+    virtual uint16_t bufferSize() const;
+    virtual uint8_t bufferByteAt(uint16_t offset) const;
+    virtual void getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const;
+    virtual void setBufferByteAt(uint16_t offset, uint8_t value);
+    virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count);
+    virtual uint8_t* bufferData(uint16_t offset);
+        
+protected:
+    virtual Modbus::Response exec(uint8_t &slave, uint8_t func, uint16_t szInBuff, uint16_t* szOutBuff);
+
+private:
+    ModbusMasterTCP* m_master;
+    ModbusMasterTCPChannel* m_nextChannel;
+    ModbusMasterTCP::Pending m_pending;
+    uint8_t m_slave;
+    uint8_t m_func;
+    uint8_t m_buff[MB_TCP_IO_BUFF_SZ];
+    uint16_t m_sz;
+    bool m_pipelineEnabled;
+};
+
+#endif // MODBUSMASTERTCPCHANNEL_H
@@ -0,0 +1,266 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusMasterTCPPool.h"
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <utility/socket.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------- MODBUS MASTER TCP POOL ----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusMasterTCPPool::ModbusMasterTCPPool()
+{
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        m_entries[i].state = ENTRY_EMPTY;
+        m_entries[i].sock = MAX_SOCK_NUM;
+        m_entries[i].wait = false;
+        m_entries[i].owner = MB_NULLPTR;
+    }
+    m_timeout = 5000;
+    resetMetrics();
+}
+
+void ModbusMasterTCPPool::resetMetrics()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_reconnects = 0;
+    m_reconnectTimeLast = 0;
+    m_reconnectTimeMax = 0;
+    m_reconnectTimeSum = 0;
+}
+
+void ModbusMasterTCPPool::process()
+{
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        Entry* e = &m_entries[i];
+        if (e->owner) // connection is borrowed by master
+            continue;
+        switch (e->state)
+        {
+        case ENTRY_DISCONNECTED:
+            if (millis()-e->start >= m_timeout) // retry interval elapsed
+                open(e);
+            break;
+        case ENTRY_CONNECTING:
+            check(e);
+            break;
+        case ENTRY_CONNECTED:
+            if (!isConnected(e)) // connection was dropped: reconnect ahead of next request
+            {
+                close(e);
+                open(e);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+Modbus::Response ModbusMasterTCPPool::acquire(ModbusMasterTCP* master, uint8_t &sock)
+{
+    uint32_t ip = (uint32_t)master->m_ip;
+    bool fRepeatAgain;
+    Entry* e;
+    
+    e = find(ip, master->m_port);
+    if (!e)
+    {
+        e = allocate();
+        if (!e)
+            return Modbus::TCP_ERR_CONNECT; // all connections are borrowed
+        e->ip = ip;
+        e->port = master->m_port;
+        e->state = ENTRY_DISCONNECTED;
+        e->wait = false;
+    }
+    else if (e->owner && (e->owner != master))
+        return Modbus::PROCESSING; // connection is borrowed by other master
+    e->owner = master;
+    e->used = millis();
+    do
+    {
+        fRepeatAgain = false;
+        switch (e->state)
+        {
+        case ENTRY_CONNECTED:
+            if (isConnected(e))
+            {
+                if (!e->wait)
+                    m_hits++;
+                e->wait = false;
+                sock = e->sock;
+                return Modbus::OK;
+            }
+            close(e);
+            // no need break
+        case ENTRY_DISCONNECTED:
+            if (!e->wait)
+            {
+                m_misses++;
+                e->wait = true;
+            }
+            open(e);
+            if (e->state != ENTRY_CONNECTING) // there is no free socket
+            {
+                e->owner = MB_NULLPTR;
+                e->wait = false;
+                return Modbus::TCP_ERR_CONNECT;
+            }
+            break;
+        default:
+            if (!e->wait)
+            {
+                m_misses++;
+                e->wait = true;
+            }
+            check(e);
+            if (e->state == ENTRY_CONNECTED)
+            {
+                fRepeatAgain = true;
+                break;
+            }
+            if (e->state == ENTRY_DISCONNECTED) // connect timeout elapsed
+            {
+                e->owner = MB_NULLPTR;
+                e->wait = false;
+                return Modbus::TCP_ERR_CONNECT;
+            }
+            break;
+        }
+    }
+    while (fRepeatAgain);
+    return Modbus::PROCESSING;
+}
+
+void ModbusMasterTCPPool::release(ModbusMasterTCP* master)
+{
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        Entry* e = &m_entries[i];
+        if (e->owner == master)
+        {
+            e->owner = MB_NULLPTR;
+            e->used = millis();
+        }
+    }
+}
+
+void ModbusMasterTCPPool::drop(ModbusMasterTCP* master)
+{
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        Entry* e = &m_entries[i];
+        if (e->owner == master)
+        {
+            e->owner = MB_NULLPTR;
+            e->wait = false;
+            close(e);
+            open(e); // reopen in background
+        }
+    }
+}
+
+ModbusMasterTCPPool::Entry* ModbusMasterTCPPool::find(uint32_t ip, uint16_t port)
+{
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        Entry* e = &m_entries[i];
+        if ((e->state != ENTRY_EMPTY) && (e->ip == ip) && (e->port == port))
+            return e;
+    }
+    return MB_NULLPTR;
+}
+
+ModbusMasterTCPPool::Entry* ModbusMasterTCPPool::allocate()
+{
+    Entry* lru = MB_NULLPTR;
+    unsigned long now = millis();
+    
+    for (uint8_t i = 0; i < MODBUS_MASTER_TCP_POOL_SZ; i++)
+    {
+        Entry* e = &m_entries[i];
+        if (e->state == ENTRY_EMPTY)
+            return e;
+        if (!e->owner && (!lru || (now-e->used > now-lru->used)))
+            lru = e;
+    }
+    if (lru) // the least recently used free connection is closed for the new slave
+    {
+        close(lru);
+        lru->state = ENTRY_EMPTY;
+    }
+    return lru;
+}
+
+void ModbusMasterTCPPool::open(Entry* e)
+{
+    e->sock = ModbusMasterTCP::openSocket(e->ip, e->port);
+    e->start = millis();
+    e->state = (e->sock == MAX_SOCK_NUM) ? ENTRY_DISCONNECTED : ENTRY_CONNECTING;
+}
+
+void ModbusMasterTCPPool::close(Entry* e)
+{
+    if (e->sock != MAX_SOCK_NUM)
+        ::close(e->sock);
+    e->sock = MAX_SOCK_NUM;
+    e->state = ENTRY_DISCONNECTED;
+}
+
+bool ModbusMasterTCPPool::isConnected(const Entry* e) const
+{
+    uint8_t s;
+    
+    if (e->sock == MAX_SOCK_NUM)
+        return false;
+    s = socketStatus(e->sock);
+    return (s == SnSR::ESTABLISHED) || ((s == SnSR::CLOSE_WAIT) && recvAvailable(e->sock));
+}
+
+void ModbusMasterTCPPool::check(Entry* e)
+{
+    unsigned long t;
+    
+    if (socketStatus(e->sock) == SnSR::ESTABLISHED)
+    {
+        t = millis()-e->start;
+        m_reconnects++;
+        m_reconnectTimeLast = t;
+        m_reconnectTimeSum += t;
+        if (t > m_reconnectTimeMax)
+            m_reconnectTimeMax = t;
+        e->state = ENTRY_CONNECTED;
+    }
+    else if (millis()-e->start >= m_timeout)
+    {
+        close(e);
+        e->start = millis(); // retry after timeout in 'process'
+    }
+}
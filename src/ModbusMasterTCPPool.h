@@ -0,0 +1,107 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSMASTERTCPPOOL_H
+#define MODBUSMASTERTCPPOOL_H
+
+#include "ModbusMasterTCP.h"
+
+// default count of connections (sockets) that pool can keep open at the same time
+#ifndef MODBUS_MASTER_TCP_POOL_SZ
+#define MODBUS_MASTER_TCP_POOL_SZ 4
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ---------------------------------------- MODBUS MASTER TCP POOL ----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Keeps TCP connections to remote slaves keyed by (ip, port). ModbusMasterTCP with pool (see 'setPool')
+// borrows connection for request and returns it back when there are no requests in flight, so connection
+// stays open for next request of the same slave. 'process' must be called in loop: it reopens dropped
+// connections in background (reconnect-ahead), so connect time is taken off the request path.
+// When all connections are in use the least recently used free connection is closed for the new slave.
+class ModbusMasterTCPPool
+{
+public:
+    ModbusMasterTCPPool();
+    
+public:
+    inline unsigned long timeout() const { return m_timeout; }
+    inline void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+    
+public: // metrics
+    inline uint32_t hits() const { return m_hits; }
+    inline uint32_t misses() const { return m_misses; }
+    inline uint32_t reconnects() const { return m_reconnects; }
+    inline unsigned long reconnectTimeLast() const { return m_reconnectTimeLast; }
+    inline unsigned long reconnectTimeMax() const { return m_reconnectTimeMax; }
+    inline unsigned long reconnectTimeAvg() const { return m_reconnects ? m_reconnectTimeSum / m_reconnects : 0; }
+    void resetMetrics();
+    
+public:
+    void process();
+    Modbus::Response acquire(ModbusMasterTCP* master, uint8_t &sock);
+    void release(ModbusMasterTCP* master);
+    void drop(ModbusMasterTCP* master);
+    
+private:
+    enum EntryState
+    {
+        ENTRY_EMPTY         ,
+        ENTRY_DISCONNECTED  ,
+        ENTRY_CONNECTING    ,
+        ENTRY_CONNECTED
+    };
+
+    struct Entry
+    {
+        uint32_t ip;
+        uint16_t port;
+        uint8_t sock;
+        uint8_t state;
+        bool wait;                  // master waits for this connection (miss is already counted)
+        ModbusMasterTCP* owner;     // master that borrowed connection
+        unsigned long start;        // time when connect was started
+        unsigned long used;         // time when connection was used last time
+    };
+
+private:
+    Entry* find(uint32_t ip, uint16_t port);
+    Entry* allocate();
+    void open(Entry* e);
+    void close(Entry* e);
+    bool isConnected(const Entry* e) const;
+    void check(Entry* e);
+
+private:
+    Entry m_entries[MODBUS_MASTER_TCP_POOL_SZ];
+    unsigned long m_timeout;
+    uint32_t m_hits;
+    uint32_t m_misses;
+    uint32_t m_reconnects;
+    unsigned long m_reconnectTimeLast;
+    unsigned long m_reconnectTimeMax;
+    unsigned long m_reconnectTimeSum;
+};
+
+#endif // MODBUSMASTERTCPPOOL_H
@@ -50,6 +50,10 @@
 #define MODBUS_MEMORY_COUNT_4x 16
 #endif
 
+#define MODBUS_MEMORY_BITS_SZ_BYTES(count) ((count)/(MODBUS_BYTE_SZ_BITES)+((count)%(MODBUS_BYTE_SZ_BITES)!=0))
+#define MODBUS_MEMORY_REGS_SZ_BITES(count) (static_cast<uint32_t>(count)*MODBUS_REGE_SZ_BITES)
+#define MODBUS_MEMORY_REGS_SZ_BYTES(count) (static_cast<uint32_t>(count)*MODBUS_REGE_SZ_BYTES)
+
 #define MODBUS_MEMORY_SZ_0x_BITES (MODBUS_MEMORY_COUNT_0x)
 #define MODBUS_MEMORY_SZ_0x_BYTES ((MODBUS_MEMORY_COUNT_0x)/(MODBUS_BYTE_SZ_BITES)+((MODBUS_MEMORY_COUNT_0x)%(MODBUS_BYTE_SZ_BITES)!=0))
 #define MODBUS_MEMORY_SZ_0x_REGES ((MODBUS_MEMORY_COUNT_0x)/(MODBUS_REGE_SZ_BITES)+((MODBUS_MEMORY_COUNT_0x)%(MODBUS_REGE_SZ_BITES)!=0))
@@ -71,41 +75,90 @@
 // ----------------------------------------- MODBUS MEMORY DEVICE -----------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-class ModbusMemory : public ModbusInterface
+/*
+    Storage of single memory table: 'Type' - type of memory (0, 1, 3, 4), 'T' - item type, 'SZ' - count of items.
+    Table with zero size is an empty class, so it takes no memory being a base of ModbusMemoryT
+*/
+template <uint8_t Type, typename T, uint32_t SZ>
+struct ModbusMemoryTable
+{
+    inline T* data() { return m_data; }
+    inline const T* data() const { return m_data; }
+    T m_data[SZ];
+};
+
+template <uint8_t Type, typename T>
+struct ModbusMemoryTable<Type, T, 0>
+{
+    inline T* data() { return 0; }
+    inline const T* data() const { return 0; }
+};
+
+#define MODBUS_MEMORY_T_TEMPLATE template <uint16_t N0x, uint16_t N1x, uint16_t N3x, uint16_t N4x>
+#define MODBUS_MEMORY_T ModbusMemoryT<N0x, N1x, N3x, N4x>
+
+/*
+    ModbusMemoryT class template has its own count of coils (N0x), discrete inputs (N1x), 
+    input registers (N3x) and holding registers (N4x) for every instantiation,
+    e.g. `ModbusMemoryT<16, 16, 0, 8> mem;`. Memory table with zero count takes no RAM and 
+    modbus functions for it return Modbus::ILLEGAL_FUNCTION.
+    ModbusMemory is ModbusMemoryT class sized by MODBUS_MEMORY_COUNT_0x/1x/3x/4x macros.
+*/
+MODBUS_MEMORY_T_TEMPLATE
+class ModbusMemoryT : public ModbusInterface,
+                      private ModbusMemoryTable<0, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N0x)>,
+                      private ModbusMemoryTable<1, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N1x)>,
+                      private ModbusMemoryTable<3, uint16_t, N3x>,
+                      private ModbusMemoryTable<4, uint16_t, N4x>
 {  
+    typedef ModbusMemoryTable<0, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N0x)> Table0x;
+    typedef ModbusMemoryTable<1, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N1x)> Table1x;
+    typedef ModbusMemoryTable<3, uint16_t, N3x> Table3x;
+    typedef ModbusMemoryTable<4, uint16_t, N4x> Table4x;
+
 public:
-    ModbusMemory();
+    ModbusMemoryT();
  
 public: // Modbus Interface
     virtual Modbus::Response readCoilStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
-    virtual Modbus::Response readInputStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = NULL);
+    virtual Modbus::Response readInputStatus(uint8_t &slave, uint16_t offset, uint16_t count, void* bits, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response readHoldingRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readHoldingRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response readInputRegisters(uint8_t &slave, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readInputRegistersBE(uint8_t &slave, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response forceSingleCoil(uint8_t &slave, uint16_t offset, bool value);
     virtual Modbus::Response forceSingleRegister(uint8_t &slave, uint16_t offset, uint16_t value);
     virtual Modbus::Response forceMultipleCoils(uint8_t &slave, uint16_t offset, uint16_t count, const void* bits, uint16_t* fact = MB_NULLPTR);
     virtual Modbus::Response forceMultipleRegisters(uint8_t &slave, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response maskWriteRegister(uint8_t &slave, uint16_t offset, uint16_t andMask, uint16_t orMask);
+    virtual Modbus::Response readWriteMultipleRegisters(uint8_t &slave, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact = MB_NULLPTR);
+    virtual Modbus::Response readWriteMultipleRegistersBE(uint8_t &slave, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact = MB_NULLPTR);
 
 public:
-    Modbus::Response copy(Modbus::Address srcType, uint16_t srcOffset, uint16_t count, Modbus::Address destType, uint16_t destOffset, uint16_t* fact = NULL);
+    Modbus::Response copy(Modbus::Address srcType, uint16_t srcOffset, uint16_t count, Modbus::Address destType, uint16_t destOffset, uint16_t* fact = MB_NULLPTR);
 
 public:
-#if MODBUS_MEMORY_COUNT_0x > 0 
-    void print_0x(Stream& serial, uint16_t offset = 0, uint16_t count = MODBUS_MEMORY_COUNT_0x, int number = DEC);
-#endif // MODBUS_MEMORY_COUNT_0x > 0
-#if MODBUS_MEMORY_COUNT_1x > 0 
-    void print_1x(Stream& serial, uint16_t offset = 0, uint16_t count = MODBUS_MEMORY_COUNT_1x, int number = DEC);
-#endif // MODBUS_MEMORY_COUNT_1x > 0
-#if MODBUS_MEMORY_COUNT_3x > 0
-    void print_3x(Stream& serial, uint16_t offset = 0, uint16_t count = MODBUS_MEMORY_COUNT_3x, int number = DEC);
-#endif // MODBUS_MEMORY_COUNT_3x > 0
-#if MODBUS_MEMORY_COUNT_4x > 0  
-    void print_4x(Stream& serial, uint16_t offset = 0, uint16_t count = MODBUS_MEMORY_COUNT_4x, int number = DEC);
-#endif // MODBUS_MEMORY_COUNT_4x > 0
-
-#if MODBUS_MEMORY_COUNT_0x > 0   
+    void print_0x(Stream& serial, uint16_t offset = 0, uint16_t count = N0x, int number = DEC);
+    void print_1x(Stream& serial, uint16_t offset = 0, uint16_t count = N1x, int number = DEC);
+    void print_3x(Stream& serial, uint16_t offset = 0, uint16_t count = N3x, int number = DEC);
+    void print_4x(Stream& serial, uint16_t offset = 0, uint16_t count = N4x, int number = DEC);
+
+public: // raw memory tables (NULL if memory is absent)
+    inline uint8_t* mem0x() { return Table0x::data(); }
+    inline const uint8_t* mem0x() const { return Table0x::data(); }
+    inline uint8_t* mem1x() { return Table1x::data(); }
+    inline const uint8_t* mem1x() const { return Table1x::data(); }
+    inline uint16_t* mem3x() { return Table3x::data(); }
+    inline const uint16_t* mem3x() const { return Table3x::data(); }
+    inline uint16_t* mem4x() { return Table4x::data(); }
+    inline const uint16_t* mem4x() const { return Table4x::data(); }
+    inline uint16_t count_0x() const { return N0x; }
+    inline uint16_t count_1x() const { return N1x; }
+    inline uint16_t count_3x() const { return N3x; }
+    inline uint16_t count_4x() const { return N4x; }
+
 public: // memory-0x management functions
-    inline void zerroAll_0x() { memset(m_mem0x, 0, MODBUS_MEMORY_SZ_0x_BYTES); }
+    inline void zerroAll_0x() { if (N0x) memset(mem0x(), 0, MODBUS_MEMORY_BITS_SZ_BYTES(N0x)); }
     Modbus::Response read_0x(uint16_t bitOffset, uint16_t bitCount, void* bits, uint16_t* fact = MB_NULLPTR) const;
     Modbus::Response write_0x(uint16_t bitOffset, uint16_t bitCount, const void* bits, uint16_t* fact = MB_NULLPTR);    
     bool bool_0x(uint16_t bitOffset) const;
@@ -130,11 +183,9 @@ public: // memory-0x management functions
     void setFloat_0x(uint16_t bitOffset, float v);
     double double_0x(uint16_t bitOffset) const;
     void setDouble_0x(uint16_t bitOffset, double v);
-#endif  // MODBUS_MEMORY_COUNT_0x > 0   
 
-#if MODBUS_MEMORY_COUNT_1x > 0   
 public: // memory-1x management functions
-    inline void zerroAll_1x() { memset(m_mem1x, 0, MODBUS_MEMORY_SZ_1x_BYTES); }
+    inline void zerroAll_1x() { if (N1x) memset(mem1x(), 0, MODBUS_MEMORY_BITS_SZ_BYTES(N1x)); }
     Modbus::Response read_1x(uint16_t bitOffset, uint16_t bitCount, void* bits, uint16_t* fact = MB_NULLPTR) const;
     Modbus::Response write_1x(uint16_t bitOffset, uint16_t bitCount, const void* bits, uint16_t* fact = MB_NULLPTR);
     bool bool_1x(uint16_t bitOffset) const;
@@ -159,11 +210,9 @@ public: // memory-1x management functions
     void setFloat_1x(uint16_t bitOffset, float v);
     double double_1x(uint16_t bitOffset) const;
     void setDouble_1x(uint16_t bitOffset, double v);
-#endif // MODBUS_MEMORY_COUNT_1x > 0   
         
-#if MODBUS_MEMORY_COUNT_3x > 0   
 public: // memory-3x management functions
-    inline void zerroAll_3x() { memset(m_mem3x, 0, MODBUS_MEMORY_SZ_3x_BYTES); }
+    inline void zerroAll_3x() { if (N3x) memset(mem3x(), 0, MODBUS_MEMORY_REGS_SZ_BYTES(N3x)); }
     Modbus::Response read_3x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR) const;
     Modbus::Response write_3x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR);
     bool bool_3x(uint32_t bitOffset) const;
@@ -188,11 +237,9 @@ public: // memory-3x management functions
     void setFloat_3x(uint16_t regOffset, float v);
     double double_3x(uint16_t regOffset) const;
     void setDouble_3x(uint16_t regOffset, double v);
-#endif // MODBUS_MEMORY_COUNT_3x > 0   
         
-#if MODBUS_MEMORY_COUNT_4x > 0   
 public: // memory-4x management functions
-    inline void zerroAll_4x() { memset(m_mem4x, 0, MODBUS_MEMORY_SZ_4x_BYTES); }
+    inline void zerroAll_4x() { if (N4x) memset(mem4x(), 0, MODBUS_MEMORY_REGS_SZ_BYTES(N4x)); }
     Modbus::Response read_4x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact = MB_NULLPTR) const;
     Modbus::Response write_4x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact = MB_NULLPTR);    
     bool bool_4x(uint32_t bitOffset) const;
@@ -217,28 +264,122 @@ public: // memory-4x management functions
     void setFloat_4x(uint16_t regOffset, float v);
     double double_4x(uint16_t regOffset) const;
     void setDouble_4x(uint16_t regOffset, double v);
-#endif // MODBUS_MEMORY_COUNT_4x > 0   
-    
-private:   
-#if MODBUS_MEMORY_COUNT_0x > 0   
-    uint8_t m_mem0x[MODBUS_MEMORY_SZ_0x_BYTES];
-#endif // MODBUS_MEMORY_COUNT_0x > 0  
- 
-#if MODBUS_MEMORY_COUNT_1x > 0   
-    uint8_t m_mem1x[MODBUS_MEMORY_SZ_1x_BYTES];
-#endif // MODBUS_MEMORY_COUNT_1x > 0  
- 
-#if MODBUS_MEMORY_COUNT_3x > 0   
-    uint16_t m_mem3x[MODBUS_MEMORY_SZ_3x_REGES];
-#endif // MODBUS_MEMORY_COUNT_3x > 0  
- 
-#if MODBUS_MEMORY_COUNT_4x > 0      
-    uint16_t m_mem4x[MODBUS_MEMORY_SZ_4x_REGES];
-#endif // MODBUS_MEMORY_COUNT_4x > 0  
- 
 };
 
-static Modbus::Response read_bits(uint16_t bitOffset, const void* mem, size_t sz_bits, void* bits, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
+// ModbusMemory sized by MODBUS_MEMORY_COUNT_0x/1x/3x/4x macros
+typedef ModbusMemoryT<MODBUS_MEMORY_COUNT_0x, MODBUS_MEMORY_COUNT_1x, MODBUS_MEMORY_COUNT_3x, MODBUS_MEMORY_COUNT_4x> ModbusMemory;
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------- BIT COPY KERNELS -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Machine word for bit copy kernels. Modbus bit memory has LSB-first bit order across bytes,
+// so whole words can be used only on little-endian cores. For AVR (8-bit core) byte is the fastest word
+#if defined(__AVR__) || !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+typedef uint8_t mb_bitword_t;
+#elif defined(__SIZEOF_POINTER__) && (__SIZEOF_POINTER__ >= 8)
+typedef uint64_t mb_bitword_t;
+#else
+typedef uint32_t mb_bitword_t;
+#endif
+
+#define MB_BITWORD_SZ_BYTES (sizeof(mb_bitword_t))
+#define MB_BITWORD_SZ_BITES (sizeof(mb_bitword_t)*MODBUS_BYTE_SZ_BITES)
+
+static inline mb_bitword_t load_bitword(const uint8_t* p)
+{
+    mb_bitword_t w;
+    memcpy(&w, p, sizeof(w)); // unaligned load
+    return w;
+}
+
+static inline void store_bitword(uint8_t* p, mb_bitword_t w)
+{
+    memcpy(p, &w, sizeof(w)); // unaligned store
+}
+
+// get whole word of bits started from 'bitOffset'. Only bytes that contain these bits are read
+static inline mb_bitword_t get_bitword(const uint8_t* mem, size_t bitOffset)
+{
+    const uint8_t* p = &mem[bitOffset/MODBUS_BYTE_SZ_BITES];
+    uint8_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;
+    mb_bitword_t w = load_bitword(p);
+    if (shift) // funnel shift: high bits of word are taken from next byte
+        w = static_cast<mb_bitword_t>((w >> shift) | (static_cast<mb_bitword_t>(p[MB_BITWORD_SZ_BYTES]) << (MB_BITWORD_SZ_BITES-shift)));
+    return w;
+}
+
+// put whole word of bits started from 'bitOffset'. Bits outside of the word's range keep their values
+static inline void put_bitword(uint8_t* mem, size_t bitOffset, mb_bitword_t w)
+{
+    uint8_t* p = &mem[bitOffset/MODBUS_BYTE_SZ_BITES];
+    uint8_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;
+    if (shift)
+    {
+        uint8_t keep = static_cast<uint8_t>((1<<shift)-1); // low bits of first byte that are not overwritten
+        store_bitword(p, static_cast<mb_bitword_t>((load_bitword(p) & keep) | (w << shift)));
+        p[MB_BITWORD_SZ_BYTES] = static_cast<uint8_t>((p[MB_BITWORD_SZ_BYTES] & ~keep) | (w >> (MB_BITWORD_SZ_BITES-shift)));
+    }
+    else
+        store_bitword(p, w);
+}
+
+// get 'count' bits (1..8) started from 'bitOffset'
+static inline uint8_t get_bitbyte(const uint8_t* mem, size_t bitOffset, uint8_t count)
+{
+    const uint8_t* p = &mem[bitOffset/MODBUS_BYTE_SZ_BITES];
+    uint8_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;
+    uint16_t v = p[0] >> shift;
+    if ((shift+count) > MODBUS_BYTE_SZ_BITES)
+        v |= static_cast<uint16_t>(p[1]) << (MODBUS_BYTE_SZ_BITES-shift);
+    return static_cast<uint8_t>(v & ((1<<count)-1));
+}
+
+// put 'count' bits (1..8) started from 'bitOffset'. Other bits keep their values
+static inline void put_bitbyte(uint8_t* mem, size_t bitOffset, uint8_t count, uint8_t v)
+{
+    uint8_t* p = &mem[bitOffset/MODBUS_BYTE_SZ_BITES];
+    uint8_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;
+    uint16_t mask = static_cast<uint16_t>(((1<<count)-1) << shift);
+    uint16_t value = static_cast<uint16_t>(v << shift) & mask;
+    p[0] = static_cast<uint8_t>((p[0] & ~mask) | value);
+    if ((shift+count) > MODBUS_BYTE_SZ_BITES)
+        p[1] = static_cast<uint8_t>((p[1] & ~(mask>>MODBUS_BYTE_SZ_BITES)) | (value>>MODBUS_BYTE_SZ_BITES));
+}
+
+// copy 'count' bits from 'src' (started from bit 'srcOffset') to 'dest' (started from bit 'destOffset').
+// Source and destination may overlap. Only bytes that contain copied bits are accessed
+static inline void copy_bits_kernel(uint8_t* dest, size_t destOffset, const uint8_t* src, size_t srcOffset, size_t count)
+{
+    size_t words = count/MB_BITWORD_SZ_BITES;
+    size_t tail = count%MB_BITWORD_SZ_BITES;
+    size_t bytes = tail/MODBUS_BYTE_SZ_BITES;
+    uint8_t resid = tail%MODBUS_BYTE_SZ_BITES;
+    size_t tailOffset = words*MB_BITWORD_SZ_BITES;
+    size_t i;
+
+    if ((dest == src) && (destOffset > srcOffset) && (destOffset < srcOffset+count))
+    {
+        // overlapped memory with destination after source - copy backward
+        if (resid)
+            put_bitbyte(dest, destOffset+tailOffset+bytes*MODBUS_BYTE_SZ_BITES, resid, get_bitbyte(src, srcOffset+tailOffset+bytes*MODBUS_BYTE_SZ_BITES, resid));
+        for (i = bytes; i--;)
+            put_bitbyte(dest, destOffset+tailOffset+i*MODBUS_BYTE_SZ_BITES, MODBUS_BYTE_SZ_BITES, get_bitbyte(src, srcOffset+tailOffset+i*MODBUS_BYTE_SZ_BITES, MODBUS_BYTE_SZ_BITES));
+        for (i = words; i--;)
+            put_bitword(dest, destOffset+i*MB_BITWORD_SZ_BITES, get_bitword(src, srcOffset+i*MB_BITWORD_SZ_BITES));
+    }
+    else
+    {
+        for (i = 0; i < words; i++)
+            put_bitword(dest, destOffset+i*MB_BITWORD_SZ_BITES, get_bitword(src, srcOffset+i*MB_BITWORD_SZ_BITES));
+        for (i = 0; i < bytes; i++)
+            put_bitbyte(dest, destOffset+tailOffset+i*MODBUS_BYTE_SZ_BITES, MODBUS_BYTE_SZ_BITES, get_bitbyte(src, srcOffset+tailOffset+i*MODBUS_BYTE_SZ_BITES, MODBUS_BYTE_SZ_BITES));
+        if (resid)
+            put_bitbyte(dest, destOffset+tailOffset+bytes*MODBUS_BYTE_SZ_BITES, resid, get_bitbyte(src, srcOffset+tailOffset+bytes*MODBUS_BYTE_SZ_BITES, resid));
+    }
+}
+
+static inline Modbus::Response read_bits(uint16_t bitOffset, const void* mem, size_t sz_bits, void* bits, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
 {
     uint16_t c;
     if (bitOffset >= sz_bits)
@@ -249,45 +390,15 @@ static Modbus::Response read_bits(uint16_t bitOffset, const void* mem, size_t sz
     else
         c = bitCount;
      
-    uint16_t byteOffset = bitOffset/MODBUS_BYTE_SZ_BITES;
-    uint16_t bytes = c/MODBUS_BYTE_SZ_BITES;
-    uint16_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;
-    if (shift)
-    {
-        for (uint16_t i = 0; i < bytes; i++)
-        {
-            uint16_t v = *(reinterpret_cast<const uint16_t*>(&reinterpret_cast<const uint8_t*>(mem)[byteOffset+i])) >> shift; 
-            reinterpret_cast<uint8_t*>(bits)[i] = static_cast<uint8_t>(v);    
-        }
-        if (uint16_t resid = c%MODBUS_BYTE_SZ_BITES)
-        {
-            int8_t mask = 0x80;
-            mask = ~(mask>>(7-resid));
-            if ((shift+resid) > MODBUS_BYTE_SZ_BITES)
-            {
-                uint16_t v = ((*reinterpret_cast<const uint16_t*>(&reinterpret_cast<const uint8_t*>(mem)[byteOffset+bytes])) >> shift) & mask;
-                reinterpret_cast<uint8_t*>(bits)[bytes] = static_cast<uint8_t>(v);
-            }
-            else
-                reinterpret_cast<uint8_t*>(bits)[bytes] = (reinterpret_cast<const uint8_t*>(mem)[byteOffset+bytes]>>shift) & mask;
-        }
-    }
-    else
-    {
-        memcpy(bits, &reinterpret_cast<const uint8_t*>(mem)[byteOffset], bytes);
-        if (uint16_t resid = c%MODBUS_BYTE_SZ_BITES)
-        {
-            int8_t mask = 0x80;
-            mask = ~(mask>>(7-resid));
-            reinterpret_cast<uint8_t*>(bits)[bytes] = reinterpret_cast<const uint8_t*>(mem)[byteOffset+bytes] & mask;
-        }
-    }
+    copy_bits_kernel(reinterpret_cast<uint8_t*>(bits), 0, reinterpret_cast<const uint8_t*>(mem), bitOffset, c);
+    if (uint16_t resid = c%MODBUS_BYTE_SZ_BITES) // unused bits of last byte are zero
+        reinterpret_cast<uint8_t*>(bits)[c/MODBUS_BYTE_SZ_BITES] &= static_cast<uint8_t>((1<<resid)-1);
     if (fact)
         *fact = c;
     return Modbus::OK;  
 }
 
-static Modbus::Response write_bits(uint16_t bitOffset, void* mem, size_t sz_bits, const void* bits, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
+static inline Modbus::Response write_bits(uint16_t bitOffset, void* mem, size_t sz_bits, const void* bits, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
 {
     uint16_t c;
     if (bitOffset >= sz_bits)
@@ -297,63 +408,15 @@ static Modbus::Response write_bits(uint16_t bitOffset, void* mem, size_t sz_bits
         c = sz_bits - bitOffset;
     else
         c = bitCount;
-    uint16_t byteOffset = bitOffset/MODBUS_BYTE_SZ_BITES;    
-    uint16_t bytes = c/MODBUS_BYTE_SZ_BITES;    
-    uint16_t shift = bitOffset%MODBUS_BYTE_SZ_BITES;    
-    if (shift)
-    {
-        for (uint16_t i = 0; i < bytes; i++)
-        {
-            uint16_t mask = 0x00FF << shift;
-            uint16_t v = static_cast<uint16_t>(reinterpret_cast<const uint8_t*>(bits)[i]) << shift;
-            *reinterpret_cast<uint16_t*>(&static_cast<uint8_t*>(mem)[byteOffset+i]) &= ~mask; // zero undermask bits
-            *reinterpret_cast<uint16_t*>(&static_cast<uint8_t*>(mem)[byteOffset+i]) |= v; // set bit values  
-        }
-        if (uint16_t resid = c%MODBUS_BYTE_SZ_BITES)
-        {
-            if ((shift+resid) > MODBUS_BYTE_SZ_BITES)
-            {
-                int16_t m = 0x8000; // using signed mask for right shift filled by '1'-bit
-                m = m>>(resid-1);
-                uint16_t mask = *reinterpret_cast<uint16_t*>(&m);
-                mask = mask >> (MODBUS_REGE_SZ_BITES-resid-shift);
-                uint16_t v = (static_cast<uint16_t>(reinterpret_cast<const uint8_t*>(bits)[bytes]) << shift) & mask;
-                *reinterpret_cast<uint16_t*>(&reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes]) &= ~mask; // zero undermask bits
-                *reinterpret_cast<uint16_t*>(&reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes]) |= v;
-            }
-            else
-            {
-                int8_t m = 0x80; // using signed mask for right shift filled by '1'-bit
-                m = m>>(resid-1);
-                uint8_t mask = *reinterpret_cast<uint8_t*>(&m);
-                mask = mask >> (MODBUS_BYTE_SZ_BITES-resid-shift);
-                uint8_t v = (reinterpret_cast<const uint8_t*>(bits)[bytes] << shift) & mask;
-                reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes] &= ~mask; // zero undermask bits
-                reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes] |= v;
-            }
-        }
-    }
-    else
-    {
-        memcpy(&reinterpret_cast<uint8_t*>(mem)[byteOffset], bits, bytes);
-        if (uint16_t resid = c%MODBUS_BYTE_SZ_BITES)
-        {
-            int8_t mask = 0x80;
-            mask = mask>>(7-resid);
-            reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes] &= mask;
-            mask = ~mask;
-            reinterpret_cast<uint8_t*>(mem)[byteOffset+bytes] |= (reinterpret_cast<const uint8_t*>(bits)[bytes] & mask);
-        }
-    }
+
+    copy_bits_kernel(reinterpret_cast<uint8_t*>(mem), bitOffset, reinterpret_cast<const uint8_t*>(bits), 0, c);
     if (fact)
         *fact = c;
     return Modbus::OK; 
 }
 
-static Modbus::Response copy_bits(uint16_t bitOffsetDest, void* dest, size_t sz_bits_dest, uint16_t bitOffsetSrc, const void* src, size_t sz_bits_src, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
+static inline Modbus::Response copy_bits(uint16_t bitOffsetDest, void* dest, size_t sz_bits_dest, uint16_t bitOffsetSrc, const void* src, size_t sz_bits_src, uint16_t bitCount, uint16_t* fact = MB_NULLPTR)
 {
-    const uint16_t sz_buff_bytes = 32;
-    const uint16_t sz_buff_bites = sz_buff_bytes*MODBUS_BYTE_SZ_BITES;
     uint16_t c;
     
     c = bitCount;
@@ -369,23 +432,14 @@ static Modbus::Response copy_bits(uint16_t bitOffsetDest, void* dest, size_t sz_
     if ((bitOffsetSrc+c) > sz_bits_src)
         c = sz_bits_src - bitOffsetSrc;
 
-    uint16_t f = c;
-    while (c)
-    {
-        uint8_t buff[sz_buff_bytes];
-        uint16_t cc = (c > sz_buff_bites) ? sz_buff_bites : c;
-        read_bits(bitOffsetSrc, src, sz_bits_src, buff, cc);
-        write_bits(bitOffsetDest, dest, sz_bits_dest, buff, cc);
-        bitOffsetDest += cc;
-        bitOffsetSrc += cc;
-        c -= cc;
-    }
+    copy_bits_kernel(reinterpret_cast<uint8_t*>(dest), bitOffsetDest, reinterpret_cast<const uint8_t*>(src), bitOffsetSrc, c);
     if (fact)
-        *fact = f;
+        *fact = c;
     return Modbus::OK;
 }
 
-ModbusMemory::ModbusMemory()
+MODBUS_MEMORY_T_TEMPLATE
+MODBUS_MEMORY_T::ModbusMemoryT()
 {
 }
 
@@ -393,267 +447,287 @@ ModbusMemory::ModbusMemory()
 // ---------------------------------------- MODBUS MASTER INTERFACE ---------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-Modbus::Response ModbusMemory::readCoilStatus(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readCoilStatus(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_0x > 0
+    if (!N0x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return read_0x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::readInputStatus(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readInputStatus(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_1x > 0
+    if (!N1x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return read_1x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::readHoldingRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readHoldingRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_4x > 0
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return read_4x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::readInputRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readInputRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_3x > 0
+    if (!N3x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return read_3x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::forceSingleCoil(uint8_t &/*slave*/, uint16_t offset, bool value)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readHoldingRegistersBE(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
+{
+    uint16_t c;
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
+    if (offset >= N4x)
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+     
+    if ((offset+count) > N4x)
+        c = N4x - offset;
+    else
+        c = count;
+     
+    Modbus::setRegsBE(bytes, c, &mem4x()[offset]);
+     
+    if (fact)
+        *fact = c;
+    return Modbus::OK;
+}
+ 
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readInputRegistersBE(uint8_t &/*slave*/, uint16_t offset, uint16_t count, void* bytes, uint16_t* fact)
 {
- #if MODBUS_MEMORY_COUNT_0x > 0
+    uint16_t c;
+    if (!N3x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
+    if (offset >= N3x)
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+     
+    if ((offset+count) > N3x)
+        c = N3x - offset;
+    else
+        c = count;
+     
+    Modbus::setRegsBE(bytes, c, &mem3x()[offset]);
+     
+    if (fact)
+        *fact = c;
+    return Modbus::OK;
+}
+ 
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::forceSingleCoil(uint8_t &/*slave*/, uint16_t offset, bool value)
+{
+    if (!N0x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return write_0x(offset, 1, &value);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::forceSingleRegister(uint8_t &/*slave*/, uint16_t offset, uint16_t value)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::forceSingleRegister(uint8_t &/*slave*/, uint16_t offset, uint16_t value)
 {
-#if MODBUS_MEMORY_COUNT_4x > 0
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return write_4x(offset, 1, &value);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::forceMultipleCoils(uint8_t &/*slave*/, uint16_t offset, uint16_t count, const void* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::forceMultipleCoils(uint8_t &/*slave*/, uint16_t offset, uint16_t count, const void* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_0x > 0
+    if (!N0x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return write_0x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
  
-Modbus::Response ModbusMemory::forceMultipleRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::forceMultipleRegisters(uint8_t &/*slave*/, uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
 {
-#if MODBUS_MEMORY_COUNT_4x > 0
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
     return write_4x(offset, count, values, fact);
-#else
-    return Modbus::ILLEGAL_FUNCTION;
-#endif
 }
 
-Modbus::Response ModbusMemory::copy(Modbus::Address typeFrom, uint16_t offsetFrom, uint16_t count, Modbus::Address typeTo, uint16_t offsetTo, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::maskWriteRegister(uint8_t &/*slave*/, uint16_t offset, uint16_t andMask, uint16_t orMask)
+{
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
+    if (offset >= N4x)
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+    mem4x()[offset] = (mem4x()[offset] & andMask) | (orMask & ~andMask);
+    return Modbus::OK;
+}
+
+// both ranges are checked before memory is changed, so error response means that nothing was written
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readWriteMultipleRegisters(uint8_t &/*slave*/, uint16_t readOffset, uint16_t readCount, uint16_t* readValues, uint16_t writeOffset, uint16_t writeCount, const uint16_t* writeValues, uint16_t* fact)
+{
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
+    if ((readOffset >= N4x) || (writeOffset >= N4x))
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+    write_4x(writeOffset, writeCount, writeValues);
+    return read_4x(readOffset, readCount, readValues, fact);
+}
+
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::readWriteMultipleRegistersBE(uint8_t &/*slave*/, uint16_t readOffset, uint16_t readCount, void* readBytes, uint16_t writeOffset, uint16_t writeCount, const void* writeBytes, uint16_t* fact)
+{
+    uint16_t c;
+    if (!N4x) // memory is absent
+        return Modbus::ILLEGAL_FUNCTION;
+    if ((readOffset >= N4x) || (writeOffset >= N4x))
+        return Modbus::ILLEGAL_DATA_ADDRESS;
+     
+    if ((writeOffset+writeCount) > N4x)
+        c = N4x - writeOffset;
+    else
+        c = writeCount;
+    Modbus::getRegsBE(writeBytes, c, &mem4x()[writeOffset]);
+     
+    if ((readOffset+readCount) > N4x)
+        c = N4x - readOffset;
+    else
+        c = readCount;
+    Modbus::setRegsBE(readBytes, c, &mem4x()[readOffset]);
+     
+    if (fact)
+        *fact = c;
+    return Modbus::OK;
+}
+
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::copy(Modbus::Address typeFrom, uint16_t offsetFrom, uint16_t count, Modbus::Address typeTo, uint16_t offsetTo, uint16_t* fact)
 {
     uint16_t c = count;
     switch (typeFrom)
     {
     case Modbus::X0:
-#if MODBUS_MEMORY_COUNT_0x > 0
         switch (typeTo)
         {
         case Modbus::X0:
-            return copy_bits(offsetTo, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, offsetFrom, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, c, fact);
+            return copy_bits(offsetTo, mem0x(), N0x, offsetFrom, mem0x(), N0x, c, fact);
         case Modbus::X1:
-#if MODBUS_MEMORY_COUNT_1x > 0
-            return copy_bits(offsetTo, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, offsetFrom, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, c, fact);
-#else  // MODBUS_MEMORY_COUNT_1x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_1x > 0
+            return copy_bits(offsetTo, mem1x(), N1x, offsetFrom, mem0x(), N0x, c, fact);
         case Modbus::X3:
-#if MODBUS_MEMORY_COUNT_3x > 0
-            if (offsetTo >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetTo >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_3x_REGES-offsetTo))
-                c = (MODBUS_MEMORY_SZ_3x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return read_bits(offsetFrom, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, &m_mem3x[offsetTo], c, fact);
-#else  // MODBUS_MEMORY_COUNT_3x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_3x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N3x-offsetTo))
+                c = (N3x-offsetTo)*MODBUS_REGE_SZ_BITES;
+            return read_bits(offsetFrom, mem0x(), N0x, &mem3x()[offsetTo], c, fact);
         case Modbus::X4:
-#if MODBUS_MEMORY_COUNT_4x > 0
-            if (offsetTo >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetTo >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_4x_REGES-offsetTo))
-                c = (MODBUS_MEMORY_SZ_4x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return read_bits(offsetFrom, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, &m_mem4x[offsetTo], c, fact);
-#else  // MODBUS_MEMORY_COUNT_4x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_4x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N4x-offsetTo))
+                c = (N4x-offsetTo)*MODBUS_REGE_SZ_BITES;
+            return read_bits(offsetFrom, mem0x(), N0x, &mem4x()[offsetTo], c, fact);
         }
         break;
-#else  // MODBUS_MEMORY_COUNT_0x > 0
-        return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_0x > 0
     case Modbus::X1:
-#if MODBUS_MEMORY_COUNT_1x > 0
         switch (typeTo)
         {
         case Modbus::X0:
-#if MODBUS_MEMORY_COUNT_0x > 0
-            return copy_bits(offsetTo, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, offsetFrom, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, c, fact);
-#else  // MODBUS_MEMORY_COUNT_0x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_0x > 0
+            return copy_bits(offsetTo, mem0x(), N0x, offsetFrom, mem1x(), N1x, c, fact);
         case Modbus::X1:
-            return copy_bits(offsetTo, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, offsetFrom, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, c, fact);
+            return copy_bits(offsetTo, mem1x(), N1x, offsetFrom, mem1x(), N1x, c, fact);
         case Modbus::X3:
-#if MODBUS_MEMORY_COUNT_3x > 0
-            if (offsetTo >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetTo >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_3x_REGES-offsetTo))
-                c = (MODBUS_MEMORY_SZ_3x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return read_bits(offsetFrom, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, &m_mem3x[offsetTo], c, fact);
-#else  // MODBUS_MEMORY_COUNT_3x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_3x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N3x-offsetTo))
+                c = (N3x-offsetTo)*MODBUS_REGE_SZ_BITES;
+            return read_bits(offsetFrom, mem1x(), N1x, &mem3x()[offsetTo], c, fact);
         case Modbus::X4:
-#if MODBUS_MEMORY_COUNT_4x > 0
-            if (offsetTo >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetTo >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_4x_REGES-offsetTo))
-                c = (MODBUS_MEMORY_SZ_4x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return read_bits(offsetFrom, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, &m_mem4x[offsetTo], c, fact);
-#else  // MODBUS_MEMORY_COUNT_4x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_4x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N4x-offsetTo))
+                c = (N4x-offsetTo)*MODBUS_REGE_SZ_BITES;
+            return read_bits(offsetFrom, mem1x(), N1x, &mem4x()[offsetTo], c, fact);
         }
         break;
-#else  // MODBUS_MEMORY_COUNT_1x > 0
-        return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_1x > 0
     case Modbus::X3:
-#if MODBUS_MEMORY_COUNT_3x > 0
         switch (typeTo)
         {
         case Modbus::X0:
-#if MODBUS_MEMORY_COUNT_0x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetFrom >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_3x_REGES-offsetFrom))
-                c = (MODBUS_MEMORY_SZ_3x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return write_bits(offsetTo, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, &m_mem3x[offsetFrom], c, fact);
-#else  // MODBUS_MEMORY_COUNT_0x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_0x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N3x-offsetFrom))
+                c = (N3x-offsetFrom)*MODBUS_REGE_SZ_BITES;
+            return write_bits(offsetTo, mem0x(), N0x, &mem3x()[offsetFrom], c, fact);
         case Modbus::X1:
-#if MODBUS_MEMORY_COUNT_1x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetFrom >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_3x_REGES-offsetFrom))
-                c = (MODBUS_MEMORY_SZ_3x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return write_bits(offsetTo, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, &m_mem3x[offsetFrom], c, fact);
-#else  // MODBUS_MEMORY_COUNT_1x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_1x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N3x-offsetFrom))
+                c = (N3x-offsetFrom)*MODBUS_REGE_SZ_BITES;
+            return write_bits(offsetTo, mem1x(), N1x, &mem3x()[offsetFrom], c, fact);
         case Modbus::X3:
-            if (offsetFrom >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetFrom >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetFrom+c) > MODBUS_MEMORY_SZ_3x_REGES)
-                c = MODBUS_MEMORY_SZ_3x_REGES - offsetFrom;
-            if (offsetTo >= MODBUS_MEMORY_SZ_3x_REGES)
+            if ((offsetFrom+c) > N3x)
+                c = N3x - offsetFrom;
+            if (offsetTo >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetTo+c) > MODBUS_MEMORY_SZ_3x_REGES)
-                c = MODBUS_MEMORY_SZ_3x_REGES - offsetTo;
-            memmove(&m_mem3x[offsetTo], &m_mem3x[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
+            if ((offsetTo+c) > N3x)
+                c = N3x - offsetTo;
+            memmove(&mem3x()[offsetTo], &mem3x()[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
             return Modbus::OK;
         case Modbus::X4:
-#if MODBUS_MEMORY_COUNT_4x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_3x_REGES)
+            if (offsetFrom >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetFrom+c) > MODBUS_MEMORY_SZ_3x_REGES)
-                c = MODBUS_MEMORY_SZ_3x_REGES - offsetFrom;
-            if (offsetTo >= MODBUS_MEMORY_SZ_4x_REGES)
+            if ((offsetFrom+c) > N3x)
+                c = N3x - offsetFrom;
+            if (offsetTo >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetTo+c) > MODBUS_MEMORY_SZ_4x_REGES)
-                c = MODBUS_MEMORY_SZ_4x_REGES - offsetTo;
-            memcpy(&m_mem4x[offsetTo], &m_mem3x[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
+            if ((offsetTo+c) > N4x)
+                c = N4x - offsetTo;
+            memcpy(&mem4x()[offsetTo], &mem3x()[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
             return Modbus::OK;
-#else  // MODBUS_MEMORY_COUNT_4x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_4x > 0
         }
         break;
-#else  // MODBUS_MEMORY_COUNT_3x > 0
-        return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_3x > 0
     case Modbus::X4:
-#if MODBUS_MEMORY_COUNT_4x > 0
         switch (typeTo)
         {
         case Modbus::X0:
-#if MODBUS_MEMORY_COUNT_0x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetFrom >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_4x_REGES-offsetFrom))
-                c = (MODBUS_MEMORY_SZ_4x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return write_bits(offsetTo, m_mem0x, MODBUS_MEMORY_SZ_0x_BITES, &m_mem4x[offsetFrom], c, fact);
-#else  // MODBUS_MEMORY_COUNT_0x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_0x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N4x-offsetFrom))
+                c = (N4x-offsetFrom)*MODBUS_REGE_SZ_BITES;
+            return write_bits(offsetTo, mem0x(), N0x, &mem4x()[offsetFrom], c, fact);
         case Modbus::X1:
-#if MODBUS_MEMORY_COUNT_1x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetFrom >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;
-            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (MODBUS_MEMORY_SZ_4x_REGES-offsetFrom))
-                c = (MODBUS_MEMORY_SZ_4x_REGES-offsetTo)*MODBUS_REGE_SZ_BITES;
-            return write_bits(offsetTo, m_mem1x, MODBUS_MEMORY_SZ_1x_BITES, &m_mem4x[offsetFrom], c, fact);
-#else  // MODBUS_MEMORY_COUNT_1x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_1x > 0
+            if ((c/MODBUS_REGE_SZ_BITES+(c%MODBUS_REGE_SZ_BITES!=0)) > (N4x-offsetFrom))
+                c = (N4x-offsetFrom)*MODBUS_REGE_SZ_BITES;
+            return write_bits(offsetTo, mem1x(), N1x, &mem4x()[offsetFrom], c, fact);
         case Modbus::X3:
-#if MODBUS_MEMORY_COUNT_3x > 0
-            if (offsetFrom >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetFrom >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetFrom+c) > MODBUS_MEMORY_SZ_4x_REGES)
-                c = MODBUS_MEMORY_SZ_4x_REGES - offsetFrom;
-            if (offsetTo >= MODBUS_MEMORY_SZ_3x_REGES)
+            if ((offsetFrom+c) > N4x)
+                c = N4x - offsetFrom;
+            if (offsetTo >= N3x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetTo+c) > MODBUS_MEMORY_SZ_3x_REGES)
-                c = MODBUS_MEMORY_SZ_3x_REGES - offsetTo;
-            memcpy(&m_mem3x[offsetTo], &m_mem4x[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
+            if ((offsetTo+c) > N3x)
+                c = N3x - offsetTo;
+            memcpy(&mem3x()[offsetTo], &mem4x()[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
             return Modbus::OK;
-#else  // MODBUS_MEMORY_COUNT_3x > 0
-            return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_3x > 0
         case Modbus::X4:
-            if (offsetFrom >= MODBUS_MEMORY_SZ_4x_REGES)
+            if (offsetFrom >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetFrom+c) > MODBUS_MEMORY_SZ_4x_REGES)
-                c = MODBUS_MEMORY_SZ_4x_REGES - offsetFrom;
-            if (offsetTo >= MODBUS_MEMORY_SZ_4x_REGES)
+            if ((offsetFrom+c) > N4x)
+                c = N4x - offsetFrom;
+            if (offsetTo >= N4x)
                 return Modbus::ILLEGAL_DATA_ADDRESS;             
-            if ((offsetTo+c) > MODBUS_MEMORY_SZ_4x_REGES)
-                c = MODBUS_MEMORY_SZ_4x_REGES - offsetTo;
-            memmove(&m_mem4x[offsetTo], &m_mem4x[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
+            if ((offsetTo+c) > N4x)
+                c = N4x - offsetTo;
+            memmove(&mem4x()[offsetTo], &mem4x()[offsetFrom], c*MODBUS_REGE_SZ_BYTES);
             return Modbus::OK;
         }
         break;
-#else  // MODBUS_MEMORY_COUNT_4x > 0
-        return Modbus::ILLEGAL_DATA_ADDRESS;
-#endif // MODBUS_MEMORY_COUNT_4x > 0
     }
     return Modbus::ILLEGAL_DATA_ADDRESS;
 }
@@ -662,749 +736,831 @@ Modbus::Response ModbusMemory::copy(Modbus::Address typeFrom, uint16_t offsetFro
 // ------------------------------------ MODBUS MEMORY PRINT FUNCTIONS -------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-#if MODBUS_MEMORY_COUNT_0x > 0
-void ModbusMemory::print_0x(Stream& serial, uint16_t offset, uint16_t count, int /*number*/)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::print_0x(Stream& serial, uint16_t offset, uint16_t count, int /*number*/)
 {
     uint16_t last = offset+count;
-    if (last > MODBUS_MEMORY_COUNT_0x)
-        last = MODBUS_MEMORY_COUNT_0x;
+    if (last > N0x)
+        last = N0x;
     for (uint16_t i = offset; i < last; i++)
     {
       
-        Serial.print((m_mem0x[i/8] & (1<<i%8))!=0);
-        Serial.print(' ');
+        serial.print((mem0x()[i/8] & (1<<i%8))!=0);
+        serial.print(' ');
     }
-    Serial.println(); 
+    serial.println(); 
 }
-#endif  // MODBUS_MEMORY_COUNT_0x > 0
 
-#if MODBUS_MEMORY_COUNT_1x > 0
-void ModbusMemory::print_1x(Stream& serial, uint16_t offset, uint16_t count, int /*number*/)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::print_1x(Stream& serial, uint16_t offset, uint16_t count, int /*number*/)
 {
     uint16_t last = offset+count;
-    if (last > MODBUS_MEMORY_COUNT_1x)
-        last = MODBUS_MEMORY_COUNT_1x;
+    if (last > N1x)
+        last = N1x;
     for (uint16_t i = offset; i < last; i++)
     {
-        Serial.print((m_mem1x[i/8] & (1<<i%8))!=0);
-        Serial.print(' ');
+        serial.print((mem1x()[i/8] & (1<<i%8))!=0);
+        serial.print(' ');
     }
-    Serial.println(); 
+    serial.println(); 
 }
-#endif  // MODBUS_MEMORY_COUNT_1x > 0
 
-#if MODBUS_MEMORY_COUNT_3x > 0
-void ModbusMemory::print_3x(Stream& serial, uint16_t offset, uint16_t count, int number)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::print_3x(Stream& serial, uint16_t offset, uint16_t count, int number)
 {
     uint16_t last = offset+count;
-    if (last > MODBUS_MEMORY_COUNT_3x)
-        last = MODBUS_MEMORY_COUNT_3x;
+    if (last > N3x)
+        last = N3x;
     for (uint16_t i = offset; i < last; i++)
     {
-        Serial.print(m_mem3x[i], number);
-        Serial.print(' ');
+        serial.print(mem3x()[i], number);
+        serial.print(' ');
     }
-    Serial.println();
+    serial.println();
 }
 
-#endif  // MODBUS_MEMORY_COUNT_3x > 0
-
-#if MODBUS_MEMORY_COUNT_4x > 0
-void ModbusMemory::print_4x(Stream& serial, uint16_t offset, uint16_t count, int number)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::print_4x(Stream& serial, uint16_t offset, uint16_t count, int number)
 {
     uint16_t last = offset+count;
-    if (last > MODBUS_MEMORY_COUNT_3x)
-        last = MODBUS_MEMORY_COUNT_3x;
+    if (last > N4x)
+        last = N4x;
     for (uint16_t i = offset; i < last; i++)
     {
-        Serial.print(m_mem4x[i], number);
-        Serial.print(' ');
+        serial.print(mem4x()[i], number);
+        serial.print(' ');
     }
-    Serial.println(); 
+    serial.println(); 
 }
-#endif  // MODBUS_MEMORY_COUNT_4x > 0
 
 // --------------------------------------------------------------------------------------------------------
 // --------------------------------------- MODBUS MEMORY 0x (COILS) ---------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-#if MODBUS_MEMORY_COUNT_0x > 0
-
-Modbus::Response ModbusMemory::read_0x(uint16_t bitOffset, uint16_t bitCount, void* bits, uint16_t* fact) const
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::read_0x(uint16_t bitOffset, uint16_t bitCount, void* bits, uint16_t* fact) const
 {
-    return read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, bits, bitCount, fact);
+    return read_bits(bitOffset, mem0x(), N0x, bits, bitCount, fact);
 }
 
-Modbus::Response ModbusMemory::write_0x(uint16_t bitOffset, uint16_t bitCount, const void* bits, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::write_0x(uint16_t bitOffset, uint16_t bitCount, const void* bits, uint16_t* fact)
 {
-    return write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, bits, bitCount, fact);
+    return write_bits(bitOffset, mem0x(), N0x, bits, bitCount, fact);
 }
 
-bool ModbusMemory::bool_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+bool MODBUS_MEMORY_T::bool_0x(uint16_t bitOffset) const
 {
-    if (bitOffset < MODBUS_MEMORY_COUNT_0x)
-        return GET_BIT(m_mem0x, bitOffset);
+    if (bitOffset < N0x)
+        return GET_BIT(mem0x(), bitOffset);
     return false;
 }
 
-void ModbusMemory::setBool_0x(uint16_t bitOffset, bool v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setBool_0x(uint16_t bitOffset, bool v)
 {
-    if (bitOffset < MODBUS_MEMORY_COUNT_0x)
-        SET_BIT(m_mem0x, bitOffset, v);
+    if (bitOffset < N0x)
+        SET_BIT(mem0x(), bitOffset, v);
 }
 
-int8_t ModbusMemory::int8_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int8_t MODBUS_MEMORY_T::int8_0x(uint16_t bitOffset) const
 {
     int8_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
  
-void ModbusMemory::setInt8_0x(uint16_t bitOffset, int8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt8_0x(uint16_t bitOffset, int8_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint8_t ModbusMemory::uint8_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint8_t MODBUS_MEMORY_T::uint8_0x(uint16_t bitOffset) const
 {
     uint8_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt8_0x(uint16_t bitOffset, uint8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt8_0x(uint16_t bitOffset, uint8_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int16_t ModbusMemory::int16_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int16_t MODBUS_MEMORY_T::int16_0x(uint16_t bitOffset) const
 {
     int16_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt16_0x(uint16_t bitOffset, int16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt16_0x(uint16_t bitOffset, int16_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint16_t ModbusMemory::uint16_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint16_t MODBUS_MEMORY_T::uint16_0x(uint16_t bitOffset) const
 {
     uint16_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt16_0x(uint16_t bitOffset, uint16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt16_0x(uint16_t bitOffset, uint16_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int32_t ModbusMemory::int32_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int32_t MODBUS_MEMORY_T::int32_0x(uint16_t bitOffset) const
 {
     int32_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt32_0x(uint16_t bitOffset, int32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt32_0x(uint16_t bitOffset, int32_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint32_t ModbusMemory::uint32_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint32_t MODBUS_MEMORY_T::uint32_0x(uint16_t bitOffset) const
 {
     uint32_t v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt32_0x(uint16_t bitOffset, uint32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt32_0x(uint16_t bitOffset, uint32_t v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int ModbusMemory::int_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int MODBUS_MEMORY_T::int_0x(uint16_t bitOffset) const
 {
     int v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt_0x(uint16_t bitOffset, int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt_0x(uint16_t bitOffset, int v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-unsigned int ModbusMemory::uint_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+unsigned int MODBUS_MEMORY_T::uint_0x(uint16_t bitOffset) const
 {
     unsigned int v = 0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt_0x(uint16_t bitOffset, unsigned int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt_0x(uint16_t bitOffset, unsigned int v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-float ModbusMemory::float_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+float MODBUS_MEMORY_T::float_0x(uint16_t bitOffset) const
 {
     float v = 0.0f;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setFloat_0x(uint16_t bitOffset, float v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setFloat_0x(uint16_t bitOffset, float v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-double ModbusMemory::double_0x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+double MODBUS_MEMORY_T::double_0x(uint16_t bitOffset) const
 {
     double v = 0.0;
-    read_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setDouble_0x(uint16_t bitOffset, double v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setDouble_0x(uint16_t bitOffset, double v)
 {
-    write_bits(bitOffset, m_mem0x, MODBUS_MEMORY_COUNT_0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem0x(), N0x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-#endif // MODBUS_MEMORY_COUNT_0x > 0
-
 // --------------------------------------------------------------------------------------------------------
 // ---------------------------------- MODBUS MEMORY 1x (INPUT DISCRETES) ----------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-#if MODBUS_MEMORY_COUNT_1x > 0
-
-Modbus::Response ModbusMemory::read_1x(uint16_t offset, uint16_t count, void* bits, uint16_t* fact) const
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::read_1x(uint16_t offset, uint16_t count, void* bits, uint16_t* fact) const
 {
-    return read_bits(offset, m_mem1x, MODBUS_MEMORY_COUNT_1x, bits, count, fact);
+    return read_bits(offset, mem1x(), N1x, bits, count, fact);
 }
  
-Modbus::Response ModbusMemory::write_1x(uint16_t offset, uint16_t count, const void* bits, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::write_1x(uint16_t offset, uint16_t count, const void* bits, uint16_t* fact)
 {
-    return write_bits(offset, m_mem1x, MODBUS_MEMORY_COUNT_1x, bits, count, fact);
+    return write_bits(offset, mem1x(), N1x, bits, count, fact);
 }
 
-bool ModbusMemory::bool_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+bool MODBUS_MEMORY_T::bool_1x(uint16_t bitOffset) const
 {
-    if (bitOffset < MODBUS_MEMORY_COUNT_1x)
-        return GET_BIT(m_mem1x, bitOffset);
+    if (bitOffset < N1x)
+        return GET_BIT(mem1x(), bitOffset);
     return false;
 }
 
-void ModbusMemory::setBool_1x(uint16_t bitOffset, bool v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setBool_1x(uint16_t bitOffset, bool v)
 {
-    if (bitOffset < MODBUS_MEMORY_COUNT_1x)
-        SET_BIT(m_mem1x, bitOffset, v);
+    if (bitOffset < N1x)
+        SET_BIT(mem1x(), bitOffset, v);
 }
 
-int8_t ModbusMemory::int8_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int8_t MODBUS_MEMORY_T::int8_1x(uint16_t bitOffset) const
 {  
     int8_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
  
-void ModbusMemory::setInt8_1x(uint16_t bitOffset, int8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt8_1x(uint16_t bitOffset, int8_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint8_t ModbusMemory::uint8_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint8_t MODBUS_MEMORY_T::uint8_1x(uint16_t bitOffset) const
 {
     uint8_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt8_1x(uint16_t bitOffset, uint8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt8_1x(uint16_t bitOffset, uint8_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int16_t ModbusMemory::int16_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int16_t MODBUS_MEMORY_T::int16_1x(uint16_t bitOffset) const
 {
     int16_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt16_1x(uint16_t bitOffset, int16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt16_1x(uint16_t bitOffset, int16_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint16_t ModbusMemory::uint16_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint16_t MODBUS_MEMORY_T::uint16_1x(uint16_t bitOffset) const
 {
     uint16_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt16_1x(uint16_t bitOffset, uint16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt16_1x(uint16_t bitOffset, uint16_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int32_t ModbusMemory::int32_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int32_t MODBUS_MEMORY_T::int32_1x(uint16_t bitOffset) const
 {
     int32_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt32_1x(uint16_t bitOffset, int32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt32_1x(uint16_t bitOffset, int32_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-uint32_t ModbusMemory::uint32_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint32_t MODBUS_MEMORY_T::uint32_1x(uint16_t bitOffset) const
 {
     uint32_t v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt32_1x(uint16_t bitOffset, uint32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt32_1x(uint16_t bitOffset, uint32_t v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-int ModbusMemory::int_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int MODBUS_MEMORY_T::int_1x(uint16_t bitOffset) const
 {
     int v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setInt_1x(uint16_t bitOffset, int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt_1x(uint16_t bitOffset, int v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-unsigned int ModbusMemory::uint_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+unsigned int MODBUS_MEMORY_T::uint_1x(uint16_t bitOffset) const
 {
     unsigned int v = 0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setUInt_1x(uint16_t bitOffset, unsigned int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt_1x(uint16_t bitOffset, unsigned int v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-float ModbusMemory::float_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+float MODBUS_MEMORY_T::float_1x(uint16_t bitOffset) const
 {
     float v = 0.0f;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setFloat_1x(uint16_t bitOffset, float v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setFloat_1x(uint16_t bitOffset, float v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-double ModbusMemory::double_1x(uint16_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+double MODBUS_MEMORY_T::double_1x(uint16_t bitOffset) const
 {
     double v = 0.0;
-    read_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    read_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
     return v;
 }
 
-void ModbusMemory::setDouble_1x(uint16_t bitOffset, double v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setDouble_1x(uint16_t bitOffset, double v)
 {
-    write_bits(bitOffset, m_mem1x, MODBUS_MEMORY_COUNT_1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
+    write_bits(bitOffset, mem1x(), N1x, &v, sizeof(v)*MODBUS_BYTE_SZ_BITES);
 }
 
-#endif // MODBUS_MEMORY_COUNT_1x > 0
-
 // --------------------------------------------------------------------------------------------------------
 // ---------------------------------- MODBUS MEMORY 3x (INPUT REGISTERS) ----------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-#if MODBUS_MEMORY_COUNT_3x > 0
-
-Modbus::Response ModbusMemory::read_3x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact) const
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::read_3x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact) const
 {
     uint16_t c;
-    if (offset >= MODBUS_MEMORY_COUNT_3x)
+    if (offset >= N3x)
         return Modbus::ILLEGAL_DATA_ADDRESS;
      
-    if ((offset+count) > MODBUS_MEMORY_COUNT_3x)
-        c = MODBUS_MEMORY_COUNT_3x - offset;
+    if ((offset+count) > N3x)
+        c = N3x - offset;
     else
         c = count;
      
-    memcpy(values, &m_mem3x[offset], c*sizeof(uint16_t));
+    memcpy(values, &mem3x()[offset], c*sizeof(uint16_t));
      
     if (fact)
         *fact = c;
     return Modbus::OK;
 }
  
-Modbus::Response ModbusMemory::write_3x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::write_3x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
 {
     uint16_t c;
-    if (offset >= MODBUS_MEMORY_COUNT_3x)
+    if (offset >= N3x)
         return Modbus::ILLEGAL_DATA_ADDRESS;
      
-    if ((offset+count) > MODBUS_MEMORY_COUNT_3x)
-        c = MODBUS_MEMORY_COUNT_3x - offset;
+    if ((offset+count) > N3x)
+        c = N3x - offset;
     else
         c = count;
      
-    memcpy(&m_mem3x[offset], values, c*sizeof(uint16_t));
+    memcpy(&mem3x()[offset], values, c*sizeof(uint16_t));
      
     if (fact)
         *fact = c;
     return Modbus::OK;
 }
 
-bool ModbusMemory::bool_3x(uint32_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+bool MODBUS_MEMORY_T::bool_3x(uint32_t bitOffset) const
 {
-    if (bitOffset < MODBUS_MEMORY_SZ_3x_BITES)
+    if (bitOffset < MODBUS_MEMORY_REGS_SZ_BITES(N3x))
     {
         uint16_t r;
         uint8_t b;
         r = static_cast<uint16_t>(bitOffset / MODBUS_REGE_SZ_BITES);
         b = static_cast<uint8_t>(bitOffset % MODBUS_REGE_SZ_BITES);
-        return (m_mem3x[r] & (1<<b)) != 0;
+        return (mem3x()[r] & (1<<b)) != 0;
     }
     return false;
 }
 
-void ModbusMemory::setBool_3x(uint32_t bitOffset, bool v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setBool_3x(uint32_t bitOffset, bool v)
 {
-    if (bitOffset < MODBUS_MEMORY_SZ_3x_BITES)
+    if (bitOffset < MODBUS_MEMORY_REGS_SZ_BITES(N3x))
     {
         uint16_t r;
         uint8_t b;
         r = static_cast<uint16_t>(bitOffset / MODBUS_REGE_SZ_BITES);
         b = static_cast<uint8_t>(bitOffset % MODBUS_REGE_SZ_BITES);
         if (v)
-            m_mem3x[r] |= (1<<b);
+            mem3x()[r] |= (1<<b);
         else
-            m_mem3x[r] &= (~(1<<b));
+            mem3x()[r] &= (~(1<<b));
     }
 }
 
-int8_t ModbusMemory::int8_3x(uint32_t byteOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int8_t MODBUS_MEMORY_T::int8_3x(uint32_t byteOffset) const
 {    
-    if (byteOffset < MODBUS_MEMORY_SZ_3x_BYTES)
-        return reinterpret_cast<const int8_t*>(m_mem3x)[byteOffset];
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N3x))
+        return reinterpret_cast<const int8_t*>(mem3x())[byteOffset];
     return 0;
 }
  
-void ModbusMemory::setInt8_3x(uint32_t byteOffset, int8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt8_3x(uint32_t byteOffset, int8_t v)
 {
-    if (byteOffset < MODBUS_MEMORY_SZ_3x_BYTES)
-        reinterpret_cast<int8_t*>(m_mem3x)[byteOffset] = v;
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N3x))
+        reinterpret_cast<int8_t*>(mem3x())[byteOffset] = v;
 }
 
-uint8_t ModbusMemory::uint8_3x(uint32_t byteOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint8_t MODBUS_MEMORY_T::uint8_3x(uint32_t byteOffset) const
 {    
-    if (byteOffset < MODBUS_MEMORY_SZ_3x_BYTES)
-        return reinterpret_cast<const uint8_t*>(m_mem3x)[byteOffset];
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N3x))
+        return reinterpret_cast<const uint8_t*>(mem3x())[byteOffset];
     return 0;
 }
 
-void ModbusMemory::setUInt8_3x(uint32_t byteOffset, uint8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt8_3x(uint32_t byteOffset, uint8_t v)
 {
-    if (byteOffset < MODBUS_MEMORY_SZ_3x_BYTES)
-        reinterpret_cast<uint8_t*>(m_mem3x)[byteOffset] = v;
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N3x))
+        reinterpret_cast<uint8_t*>(mem3x())[byteOffset] = v;
 }
 
-int16_t ModbusMemory::int16_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int16_t MODBUS_MEMORY_T::int16_3x(uint16_t regOffset) const
 {
     int16_t v = 0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setInt16_3x(uint16_t regOffset, int16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt16_3x(uint16_t regOffset, int16_t v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-uint16_t ModbusMemory::uint16_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint16_t MODBUS_MEMORY_T::uint16_3x(uint16_t regOffset) const
 {
     uint16_t v = 0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt16_3x(uint16_t regOffset, uint16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt16_3x(uint16_t regOffset, uint16_t v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-int32_t ModbusMemory::int32_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int32_t MODBUS_MEMORY_T::int32_3x(uint16_t regOffset) const
 {
     int32_t v = 0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setInt32_3x(uint16_t regOffset, int32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt32_3x(uint16_t regOffset, int32_t v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-uint32_t ModbusMemory::uint32_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint32_t MODBUS_MEMORY_T::uint32_3x(uint16_t regOffset) const
 {
     uint32_t v = 0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt32_3x(uint16_t regOffset, uint32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt32_3x(uint16_t regOffset, uint32_t v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-void ModbusMemory::setInt_3x(uint16_t regOffset, int v)
+MODBUS_MEMORY_T_TEMPLATE
+int MODBUS_MEMORY_T::int_3x(uint16_t regOffset) const
+{
+    int v = 0;
+    read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
+    return v;
+}
+
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt_3x(uint16_t regOffset, int v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-unsigned int ModbusMemory::uint_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+unsigned int MODBUS_MEMORY_T::uint_3x(uint16_t regOffset) const
 {
     unsigned int v = 0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt_3x(uint16_t regOffset, unsigned int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt_3x(uint16_t regOffset, unsigned int v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-float ModbusMemory::float_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+float MODBUS_MEMORY_T::float_3x(uint16_t regOffset) const
 {
     float v = 0.0f;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setFloat_3x(uint16_t regOffset, float v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setFloat_3x(uint16_t regOffset, float v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-double ModbusMemory::double_3x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+double MODBUS_MEMORY_T::double_3x(uint16_t regOffset) const
 {
     double v = 0.0;
     read_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setDouble_3x(uint16_t regOffset, double v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setDouble_3x(uint16_t regOffset, double v)
 {
     write_3x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-#endif // MODBUS_MEMORY_COUNT_3x > 0
-
 //--------------------------------------------------------------------------------------------------------
 //--------------------------------- MODBUS MEMORY 4x (HOLDING REGISTERS) ---------------------------------
 //--------------------------------------------------------------------------------------------------------
 
-#if MODBUS_MEMORY_COUNT_4x > 0
-
-Modbus::Response ModbusMemory::read_4x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact) const
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::read_4x(uint16_t offset, uint16_t count, uint16_t* values, uint16_t* fact) const
 {
     uint16_t c;
-    if (offset >= MODBUS_MEMORY_COUNT_4x)
+    if (offset >= N4x)
         return Modbus::ILLEGAL_DATA_ADDRESS;
      
-    if ((offset+count) > MODBUS_MEMORY_COUNT_4x)
-        c = MODBUS_MEMORY_COUNT_4x - offset;
+    if ((offset+count) > N4x)
+        c = N4x - offset;
     else
         c = count;
      
-    memcpy(values, &m_mem4x[offset], c*sizeof(uint16_t));
+    memcpy(values, &mem4x()[offset], c*sizeof(uint16_t));
      
     if (fact)
         *fact = c;
     return Modbus::OK;
 }
  
-Modbus::Response ModbusMemory::write_4x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
+MODBUS_MEMORY_T_TEMPLATE
+Modbus::Response MODBUS_MEMORY_T::write_4x(uint16_t offset, uint16_t count, const uint16_t* values, uint16_t* fact)
 {
     uint16_t c;
-    if (offset >= MODBUS_MEMORY_COUNT_4x)
+    if (offset >= N4x)
         return Modbus::ILLEGAL_DATA_ADDRESS;
      
-    if ((offset+count) > MODBUS_MEMORY_COUNT_4x)
-        c = MODBUS_MEMORY_COUNT_4x - offset;
+    if ((offset+count) > N4x)
+        c = N4x - offset;
     else
         c = count;
      
-    memcpy(&m_mem4x[offset], values, c*sizeof(uint16_t));
+    memcpy(&mem4x()[offset], values, c*sizeof(uint16_t));
      
     if (fact)
         *fact = c;
     return Modbus::OK;
 }
 
-bool ModbusMemory::bool_4x(uint32_t bitOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+bool MODBUS_MEMORY_T::bool_4x(uint32_t bitOffset) const
 {
-    if (bitOffset < MODBUS_MEMORY_SZ_4x_BITES)
+    if (bitOffset < MODBUS_MEMORY_REGS_SZ_BITES(N4x))
     {
         uint16_t r;
         uint8_t b;
         r = static_cast<uint16_t>(bitOffset / MODBUS_REGE_SZ_BITES);
         b = static_cast<uint8_t>(bitOffset % MODBUS_REGE_SZ_BITES);
-        return (m_mem4x[r] & (1<<b)) != 0;
+        return (mem4x()[r] & (1<<b)) != 0;
     }
     return false;
 }
 
-void ModbusMemory::setBool_4x(uint32_t bitOffset, bool v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setBool_4x(uint32_t bitOffset, bool v)
 {
-    if (bitOffset < MODBUS_MEMORY_SZ_4x_BITES)
+    if (bitOffset < MODBUS_MEMORY_REGS_SZ_BITES(N4x))
     {
         uint16_t r;
         uint8_t b;
         r = static_cast<uint16_t>(bitOffset / MODBUS_REGE_SZ_BITES);
         b = static_cast<uint8_t>(bitOffset % MODBUS_REGE_SZ_BITES);
         if (v)
-            m_mem4x[r] |= (1<<b);
+            mem4x()[r] |= (1<<b);
         else
-            m_mem4x[r] &= (~(1<<b));
+            mem4x()[r] &= (~(1<<b));
     }
 }
 
-int8_t ModbusMemory::int8_4x(uint32_t byteOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int8_t MODBUS_MEMORY_T::int8_4x(uint32_t byteOffset) const
 {
-    if (byteOffset < MODBUS_MEMORY_SZ_4x_BYTES)
-        return reinterpret_cast<const int8_t*>(m_mem4x)[byteOffset];
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N4x))
+        return reinterpret_cast<const int8_t*>(mem4x())[byteOffset];
     return 0;
 }
  
-void ModbusMemory::setInt8_4x(uint32_t byteOffset, int8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt8_4x(uint32_t byteOffset, int8_t v)
 {   
-    if (byteOffset < MODBUS_MEMORY_SZ_4x_BYTES)
-        reinterpret_cast<int8_t*>(m_mem4x)[byteOffset] = v;
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N4x))
+        reinterpret_cast<int8_t*>(mem4x())[byteOffset] = v;
 }
 
-uint8_t ModbusMemory::uint8_4x(uint32_t byteOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint8_t MODBUS_MEMORY_T::uint8_4x(uint32_t byteOffset) const
 {
-    if (byteOffset < MODBUS_MEMORY_SZ_4x_BYTES)
-        return reinterpret_cast<const uint8_t*>(m_mem4x)[byteOffset];
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N4x))
+        return reinterpret_cast<const uint8_t*>(mem4x())[byteOffset];
     return 0;
 }
 
-void ModbusMemory::setUInt8_4x(uint32_t byteOffset, uint8_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt8_4x(uint32_t byteOffset, uint8_t v)
 {
-    if (byteOffset < MODBUS_MEMORY_SZ_4x_BYTES)
-        reinterpret_cast<uint8_t*>(m_mem4x)[byteOffset] = v;
+    if (byteOffset < MODBUS_MEMORY_REGS_SZ_BYTES(N4x))
+        reinterpret_cast<uint8_t*>(mem4x())[byteOffset] = v;
 }
 
-int16_t ModbusMemory::int16_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int16_t MODBUS_MEMORY_T::int16_4x(uint16_t regOffset) const
 {
     int16_t v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setInt16_4x(uint16_t regOffset, int16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt16_4x(uint16_t regOffset, int16_t v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-uint16_t ModbusMemory::uint16_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint16_t MODBUS_MEMORY_T::uint16_4x(uint16_t regOffset) const
 {
     uint16_t v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt16_4x(uint16_t regOffset, uint16_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt16_4x(uint16_t regOffset, uint16_t v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-int32_t ModbusMemory::int32_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int32_t MODBUS_MEMORY_T::int32_4x(uint16_t regOffset) const
 {
     int32_t v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setInt32_4x(uint16_t regOffset, int32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt32_4x(uint16_t regOffset, int32_t v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-uint32_t ModbusMemory::uint32_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+uint32_t MODBUS_MEMORY_T::uint32_4x(uint16_t regOffset) const
 {
     uint32_t v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt32_4x(uint16_t regOffset, uint32_t v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt32_4x(uint16_t regOffset, uint32_t v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-int ModbusMemory::int_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+int MODBUS_MEMORY_T::int_4x(uint16_t regOffset) const
 {
     int v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setInt_4x(uint16_t regOffset, int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setInt_4x(uint16_t regOffset, int v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-unsigned int ModbusMemory::uint_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+unsigned int MODBUS_MEMORY_T::uint_4x(uint16_t regOffset) const
 {
     unsigned int v = 0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setUInt_4x(uint16_t regOffset, unsigned int v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setUInt_4x(uint16_t regOffset, unsigned int v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-float ModbusMemory::float_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+float MODBUS_MEMORY_T::float_4x(uint16_t regOffset) const
 {
     float v = 0.0f;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setFloat_4x(uint16_t regOffset, float v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setFloat_4x(uint16_t regOffset, float v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-double ModbusMemory::double_4x(uint16_t regOffset) const
+MODBUS_MEMORY_T_TEMPLATE
+double MODBUS_MEMORY_T::double_4x(uint16_t regOffset) const
 {
     double v = 0.0;
     read_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
     return v;
 }
 
-void ModbusMemory::setDouble_4x(uint16_t regOffset, double v)
+MODBUS_MEMORY_T_TEMPLATE
+void MODBUS_MEMORY_T::setDouble_4x(uint16_t regOffset, double v)
 {
     write_4x(regOffset, sizeof(v)/sizeof(uint16_t), reinterpret_cast<uint16_t*>(&v));
 }
 
-#endif // MODBUS_MEMORY_COUNT_4x > 0
-
 #endif // MODBUS_MEMORY_H
@@ -0,0 +1,261 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusMirror.h"
+
+#include <string.h>
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ----------------------------------------------- MODBUS MIRROR ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// maximum count of values in one range
+static const uint16_t c_MaxRangeRegs = (MODBUS_MIRROR_FRAME_REGS < MB_MAX_READ_REGISTERS) ? MODBUS_MIRROR_FRAME_REGS : MB_MAX_READ_REGISTERS;
+static const uint16_t c_MaxRangeBits = (MODBUS_MIRROR_FRAME_REGS*16 < MB_MAX_READ_DISCRETS) ? MODBUS_MIRROR_FRAME_REGS*16 : MB_MAX_READ_DISCRETS;
+
+// returned index that means 'no range'
+static const int8_t c_NoRange = -1;
+
+// value of 'm_current' when range of frame in process was removed by 'clear'
+static const uint8_t c_Removed = MODBUS_POLL_NONE-1;
+
+ModbusMirrorBase::ModbusMirrorBase(ModbusMaster* master, uint8_t* mem0x, uint16_t count0x, uint8_t* mem1x, uint16_t count1x, uint16_t* mem3x, uint16_t count3x, uint16_t* mem4x, uint16_t count4x)
+{
+    m_master = master;
+    m_mem0x = mem0x;
+    m_count0x = mem0x ? count0x : 0;
+    m_mem1x = mem1x;
+    m_count1x = mem1x ? count1x : 0;
+    m_mem3x = mem3x;
+    m_count3x = mem3x ? count3x : 0;
+    m_mem4x = mem4x;
+    m_count4x = mem4x ? count4x : 0;
+    m_count = 0;
+    m_current = MODBUS_POLL_NONE;
+    m_start = 0;
+    resetStatistics();
+}
+
+void ModbusMirrorBase::resetStatistics()
+{
+    m_frames = 0;
+    m_errors = 0;
+    m_status = Modbus::OK;
+}
+
+// Adds range of remote slave to mirror. Returns index of range or -1 if there is no place for range,
+// function is not a read function or range doesn't fit frame buffer or local table
+int8_t ModbusMirrorBase::addRange(uint8_t slave, uint8_t func, uint16_t offset, uint16_t count, uint16_t localOffset, unsigned long period, unsigned long maxAge)
+{
+    Range* r;
+    uint16_t limit = ModbusPoller::isBitsFunc(func) ? c_MaxRangeBits : c_MaxRangeRegs;
+    
+    if (m_count >= MODBUS_MIRROR_RANGES)
+        return c_NoRange;
+    if ((count == 0) || (count > limit) || (static_cast<uint32_t>(localOffset) + count > tableSize(func)))
+        return c_NoRange;
+    r = &m_ranges[m_count];
+    r->slave = slave;
+    r->func = func;
+    r->offset = offset;
+    r->count = count;
+    r->localOffset = localOffset;
+    r->valid = false;
+    r->refresh = false;
+    r->period = period;
+    r->maxAge = maxAge ? maxAge : period * MODBUS_MIRROR_STALE_PERIODS;
+    r->last = millis() - period; // poll at once
+    r->time = 0;
+    r->status = Modbus::PROCESSING;
+    return static_cast<int8_t>(m_count++);
+}
+
+// Removes all ranges. Local memory keeps its values.
+// Frame in process is finished by next 'exec' calls, but its values are not written to local memory
+void ModbusMirrorBase::clear()
+{
+    m_count = 0;
+    if (m_current != MODBUS_POLL_NONE)
+        m_current = c_Removed;
+}
+
+// Returns index of range that contains local bit/register 'localOffset' of table of function 'func' or -1
+int8_t ModbusMirrorBase::findRange(uint8_t func, uint16_t localOffset) const
+{
+    const Range* r;
+    uint8_t i;
+    
+    for (i = 0; i < m_count; i++)
+    {
+        r = &m_ranges[i];
+        if ((r->func == func) && (localOffset >= r->localOffset) && (localOffset - r->localOffset < r->count))
+            return static_cast<int8_t>(i);
+    }
+    return c_NoRange;
+}
+
+ModbusMirrorBase::Quality ModbusMirrorBase::quality(uint8_t range) const
+{
+    const Range* r;
+    
+    if (range >= m_count)
+        return QUALITY_NONE;
+    r = &m_ranges[range];
+    if (!r->valid)
+        return QUALITY_NONE;
+    if (r->maxAge && (millis() - r->time > r->maxAge))
+        return QUALITY_STALE;
+    return (r->status == Modbus::OK) ? QUALITY_GOOD : QUALITY_UNCERTAIN;
+}
+
+// Returns time in milliseconds since last successful poll of range (maximum value if range was not read yet)
+unsigned long ModbusMirrorBase::age(uint8_t range) const
+{
+    if ((range >= m_count) || !m_ranges[range].valid)
+        return static_cast<unsigned long>(-1);
+    return millis() - m_ranges[range].time;
+}
+
+// Returns time (millis) of last successful poll of range
+unsigned long ModbusMirrorBase::time(uint8_t range) const
+{
+    return (range < m_count) ? m_ranges[range].time : 0;
+}
+
+// Returns result of last poll of range (Modbus::PROCESSING - range was not polled yet)
+Modbus::Response ModbusMirrorBase::status(uint8_t range) const
+{
+    return (range < m_count) ? m_ranges[range].status : Modbus::ILLEGAL_DATA_ADDRESS;
+}
+
+// Makes range to be polled before any other range (e.g. when application needs fresh values)
+void ModbusMirrorBase::refresh(uint8_t range)
+{
+    if (range < m_count)
+        m_ranges[range].refresh = true;
+}
+
+Modbus::Response ModbusMirrorBase::exec()
+{
+    Range* r;
+    Modbus::Response s;
+    uint16_t fact = 0;
+    uint8_t slave;
+    
+    if (m_current == MODBUS_POLL_NONE)
+    {
+        m_current = nextRange();
+        if (m_current == MODBUS_POLL_NONE) // there is no range to poll now
+            return Modbus::OK;
+        // frame is kept apart from range, so it's finished even if range is removed
+        r = &m_ranges[m_current];
+        m_slave = r->slave;
+        m_func = r->func;
+        m_offset = r->offset;
+        m_frameCount = r->count;
+        m_start = millis();
+    }
+    slave = m_slave;
+    s = m_master->readData(m_func, slave, m_offset, m_frameCount, m_buff, &fact);
+    if (s == Modbus::PROCESSING)
+        return s;
+    m_frames++;
+    if (m_current == c_Removed)
+    {
+        m_current = MODBUS_POLL_NONE;
+        return s;
+    }
+    r = &m_ranges[m_current];
+    m_current = MODBUS_POLL_NONE;
+    r->last = m_start;
+    r->refresh = false;
+    complete(r, s, fact);
+    return r->status;
+}
+
+uint16_t ModbusMirrorBase::tableSize(uint8_t func) const
+{
+    switch (func)
+    {
+    case MBF_READ_COIL_STATUS:
+        return m_count0x;
+    case MBF_READ_INPUT_STATUS:
+        return m_count1x;
+    case MBF_READ_HOLDING_REGISTERS:
+        return m_count4x;
+    case MBF_READ_INPUT_REGISTERS:
+        return m_count3x;
+    default:
+        return 0;
+    }
+}
+
+uint8_t ModbusMirrorBase::nextRange() const
+{
+    const Range* r;
+    ModbusPollChoice choice(millis());
+    uint8_t i;
+    
+    // range that must be refreshed is polled first, then the most overdue range
+    for (i = 0; i < m_count; i++)
+    {
+        r = &m_ranges[i];
+        if (r->refresh)
+            return i;
+        choice.offer(i, r->last, r->period);
+    }
+    return choice.index();
+}
+
+void ModbusMirrorBase::complete(Range* r, Modbus::Response status, uint16_t fact)
+{
+    if ((status == Modbus::OK) && (fact != r->count))
+        status = Modbus::CMN_ERR_NOT_CORRECT; // responsed less values than requested
+    r->status = status;
+    m_status = status;
+    if (status != Modbus::OK)
+    {
+        m_errors++;
+        return;
+    }
+    // whole range is written to local memory at once, so it never has values of different polls
+    switch (r->func)
+    {
+    case MBF_READ_COIL_STATUS:
+        write_bits(r->localOffset, m_mem0x, m_count0x, m_buff, r->count);
+        break;
+    case MBF_READ_INPUT_STATUS:
+        write_bits(r->localOffset, m_mem1x, m_count1x, m_buff, r->count);
+        break;
+    case MBF_READ_HOLDING_REGISTERS:
+        memcpy(&m_mem4x[r->localOffset], m_buff, r->count * sizeof(uint16_t));
+        break;
+    default:
+        memcpy(&m_mem3x[r->localOffset], m_buff, r->count * sizeof(uint16_t));
+        break;
+    }
+    r->valid = true;
+    r->time = m_start;
+}
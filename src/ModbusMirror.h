@@ -0,0 +1,161 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSMIRROR_H
+#define MODBUSMIRROR_H
+
+#include "ModbusPoller.h"
+#include "ModbusMemory.h"
+
+// maximum count of ranges of one ModbusMirror object
+#ifndef MODBUS_MIRROR_RANGES
+#define MODBUS_MIRROR_RANGES 8
+#endif
+
+// maximum count of registers in one range (bits: 16 times more), it's size of frame buffer
+#ifndef MODBUS_MIRROR_FRAME_REGS
+#define MODBUS_MIRROR_FRAME_REGS MB_MAX_READ_REGISTERS
+#endif
+
+// default age of range values (in poll periods) after that values are stale
+#ifndef MODBUS_MIRROR_STALE_PERIODS
+#define MODBUS_MIRROR_STALE_PERIODS 3
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ----------------------------------------------- MODBUS MIRROR ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusMirrorBase keeps local image of remote slaves: ranges of remote tables are polled periodically
+    through any ModbusMaster in non blocking mode (call 'exec' in loop) and written to local memory:
+    coils (FC1) to 0x, discrete inputs (FC2) to 1x, input registers (FC4) to 3x, holding registers (FC3) to 4x table,
+    remote value 'offset'+i is local value 'localOffset'+i. One range is read by one frame, the most overdue range
+    is polled first. So every part of application reads the same values from local memory (e.g. 'uint16_4x')
+    without bus access, and the bus is loaded once whatever count of readers is.
+    Local values are changed only by successful poll of whole range, failed poll keeps previous values.
+    Every range has time of last successful poll and quality of its values: values that are older than
+    'maxAge' are stale (default: MODBUS_MIRROR_STALE_PERIODS poll periods). Local memory may be also served
+    by ModbusSlave (e.g. as gateway), but remote ranges must not be written locally: they are overwritten by next poll.
+    Ranges are scheduled like frames of ModbusPoller, but they are not merged: every range is its own local table area.
+*/
+class ModbusMirrorBase
+{
+public:
+    enum Quality
+    {
+        QUALITY_NONE        ,   // range was not read yet
+        QUALITY_GOOD        ,   // last poll succeeded and values are not older than 'maxAge'
+        QUALITY_UNCERTAIN   ,   // last poll failed, values of previous successful poll are not older than 'maxAge'
+        QUALITY_STALE           // values are older than 'maxAge'
+    };
+
+public:
+    ModbusMirrorBase(ModbusMaster* master, uint8_t* mem0x, uint16_t count0x, uint8_t* mem1x, uint16_t count1x, uint16_t* mem3x, uint16_t count3x, uint16_t* mem4x, uint16_t count4x);
+
+public:
+    inline ModbusMaster* master() const { return m_master; }
+    inline uint8_t count() const { return m_count; } // count of ranges
+
+public: // statistics
+    inline uint32_t frames() const { return m_frames; } // count of frames that was sent
+    inline uint32_t errors() const { return m_errors; } // count of failed polls
+    inline Modbus::Response status() const { return m_status; } // result of last poll
+    void resetStatistics();
+
+public:
+    int8_t addRange(uint8_t slave, uint8_t func, uint16_t offset, uint16_t count, uint16_t localOffset, unsigned long period, unsigned long maxAge = 0);
+    void clear();
+    int8_t findRange(uint8_t func, uint16_t localOffset) const;
+    Quality quality(uint8_t range) const;
+    unsigned long age(uint8_t range) const;
+    unsigned long time(uint8_t range) const;
+    Modbus::Response status(uint8_t range) const;
+    inline bool isGood(uint8_t range) const { return quality(range) == QUALITY_GOOD; }
+    void refresh(uint8_t range);
+    Modbus::Response exec();
+
+private:
+    struct Range
+    {
+        uint8_t slave;              // slave address
+        uint8_t func;               // MBF_READ_COIL_STATUS, MBF_READ_INPUT_STATUS, MBF_READ_HOLDING_REGISTERS or MBF_READ_INPUT_REGISTERS
+        uint16_t offset;            // offset of first remote bit/register
+        uint16_t count;             // count of bits/registers
+        uint16_t localOffset;       // offset of first bit/register in local table
+        bool valid;                 // range was read successfully at least once
+        bool refresh;               // range must be polled as soon as possible
+        unsigned long period;       // poll period in milliseconds (0 - as often as possible)
+        unsigned long maxAge;       // age of values in milliseconds after that they are stale (0 - never)
+        unsigned long last;         // time (millis) when range was polled last time
+        unsigned long time;         // time (millis) of last successful poll
+        Modbus::Response status;    // result of last poll
+    };
+
+private:
+    uint16_t tableSize(uint8_t func) const;
+    uint8_t nextRange() const;
+    void complete(Range* r, Modbus::Response status, uint16_t fact);
+
+private:
+    ModbusMaster* m_master;
+    uint8_t* m_mem0x;
+    uint16_t m_count0x;
+    uint8_t* m_mem1x;
+    uint16_t m_count1x;
+    uint16_t* m_mem3x;
+    uint16_t m_count3x;
+    uint16_t* m_mem4x;
+    uint16_t m_count4x;
+    Range m_ranges[MODBUS_MIRROR_RANGES];
+    uint8_t m_count;
+    // frame in process
+    uint8_t m_current;          // range of frame (MODBUS_POLL_NONE - there is no frame in process)
+    uint8_t m_slave;
+    uint8_t m_func;
+    uint16_t m_offset;
+    uint16_t m_frameCount;
+    unsigned long m_start;
+    uint16_t m_buff[MODBUS_MIRROR_FRAME_REGS];
+    // statistics
+    uint32_t m_frames;
+    uint32_t m_errors;
+    Modbus::Response m_status;
+};
+
+/*
+    ModbusMirrorT keeps image of remote slaves in ModbusMemoryT<N0x, N1x, N3x, N4x>,
+    e.g. `ModbusMirrorT<0, 0, 16, 100> mirror(&master, &image);`.
+    ModbusMirror is ModbusMirrorT for ModbusMemory.
+*/
+MODBUS_MEMORY_T_TEMPLATE
+class ModbusMirrorT : public ModbusMirrorBase
+{
+public:
+    ModbusMirrorT(ModbusMaster* master, MODBUS_MEMORY_T* memory) :
+        ModbusMirrorBase(master, memory->mem0x(), N0x, memory->mem1x(), N1x, memory->mem3x(), N3x, memory->mem4x(), N4x) {}
+};
+
+typedef ModbusMirrorT<MODBUS_MEMORY_COUNT_0x, MODBUS_MEMORY_COUNT_1x, MODBUS_MEMORY_COUNT_3x, MODBUS_MEMORY_COUNT_4x> ModbusMirror;
+
+#endif // MODBUSMIRROR_H
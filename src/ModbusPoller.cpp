@@ -0,0 +1,257 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusPoller.h"
+#include "ModbusMemory.h"
+
+#include <string.h>
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ----------------------------------------------- MODBUS POLLER ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// index value that means 'no item'
+static const uint8_t c_NoItem = MODBUS_POLL_NONE;
+
+// 'frameHead' value of item that can't be polled (wrong function or count)
+static const uint8_t c_Excluded = 0xFE;
+
+void ModbusPollChoice::offer(uint8_t index, unsigned long last, unsigned long period)
+{
+    unsigned long elapsed = m_now - last; // elapsed time is right when millis() overflows
+    if (elapsed < period)
+        return;
+    if ((m_index == MODBUS_POLL_NONE) || (elapsed - period > m_overdue))
+    {
+        m_index = index;
+        m_overdue = elapsed - period;
+    }
+}
+
+ModbusPoller::ModbusPoller(ModbusMaster* master, ModbusPollItem* items, uint8_t count)
+{
+    m_master = master;
+    m_items = items;
+    m_count = (count < c_Excluded) ? count : c_Excluded;
+    m_regsGap = MODBUS_POLLER_REGS_GAP;
+    m_bitsGap = MODBUS_POLLER_BITS_GAP;
+    m_coalesced = false;
+    m_current = c_NoItem;
+    m_start = 0;
+    m_frameCount = 0;
+    m_cyclePolled = 0;
+    m_cycleStart = 0;
+    m_cycleTime = 0;
+    m_frames = 0;
+}
+
+void ModbusPoller::coalesce()
+{
+    ModbusPollItem *h, *it;
+    uint8_t i, head, last, next;
+    uint32_t end, e;
+    uint16_t limit, gap;
+    
+    for (i = 0; i < m_count; i++)
+    {
+        it = &m_items[i];
+        it->frameHead = c_NoItem;
+        it->frameNext = c_NoItem;
+        if (isBitsFunc(it->func))
+            limit = MODBUS_POLLER_MAX_BITS;
+        else if (isRegsFunc(it->func))
+            limit = MODBUS_POLLER_MAX_REGS;
+        else
+        {
+            it->status = Modbus::ILLEGAL_FUNCTION;
+            it->frameHead = c_Excluded;
+            continue;
+        }
+        if ((it->count == 0) || (it->count > limit))
+        {
+            it->status = Modbus::ILLEGAL_DATA_VALUE;
+            it->frameHead = c_Excluded;
+            continue;
+        }
+        it->status = Modbus::PROCESSING;
+    }
+    m_frameCount = 0;
+    for (;;)
+    {
+        // item with the lowest (slave, function, offset) starts new frame
+        head = c_NoItem;
+        for (i = 0; i < m_count; i++)
+        {
+            it = &m_items[i];
+            if (it->frameHead != c_NoItem)
+                continue;
+            if ((head == c_NoItem) ||
+                (it->slave < m_items[head].slave) ||
+                ((it->slave == m_items[head].slave) && ((it->func < m_items[head].func) ||
+                                                         ((it->func == m_items[head].func) && (it->offset < m_items[head].offset)))))
+                head = i;
+        }
+        if (head == c_NoItem)
+            break;
+        h = &m_items[head];
+        h->frameHead = head;
+        h->frameOffset = h->offset;
+        h->framePeriod = h->period;
+        end = static_cast<uint32_t>(h->offset) + h->count;
+        if (isBitsFunc(h->func))
+        {
+            limit = MODBUS_POLLER_MAX_BITS;
+            gap = m_bitsGap;
+        }
+        else
+        {
+            limit = MODBUS_POLLER_MAX_REGS;
+            gap = m_regsGap;
+        }
+        // append the nearest items of the same slave and function while frame fits the limit
+        for (last = head;;)
+        {
+            next = c_NoItem;
+            for (i = 0; i < m_count; i++)
+            {
+                it = &m_items[i];
+                if ((it->frameHead != c_NoItem) || (it->slave != h->slave) || (it->func != h->func))
+                    continue;
+                if (it->offset > end + gap)
+                    continue;
+                e = static_cast<uint32_t>(it->offset) + it->count;
+                if (((e > end) ? e : end) - h->frameOffset > limit)
+                    continue;
+                if ((next == c_NoItem) || (it->offset < m_items[next].offset))
+                    next = i;
+            }
+            if (next == c_NoItem)
+                break;
+            it = &m_items[next];
+            it->frameHead = head;
+            m_items[last].frameNext = next;
+            last = next;
+            e = static_cast<uint32_t>(it->offset) + it->count;
+            if (e > end)
+                end = e;
+            if (it->period < h->framePeriod)
+                h->framePeriod = it->period;
+        }
+        h->frameCount = static_cast<uint16_t>(end - h->frameOffset);
+        h->frameLast = millis() - h->framePeriod; // poll at once
+        h->frameCycle = false;
+        m_frameCount++;
+    }
+    m_current = c_NoItem;
+    m_cyclePolled = 0;
+    m_cycleStart = millis();
+    m_coalesced = true;
+}
+
+Modbus::Response ModbusPoller::exec()
+{
+    ModbusPollItem* h;
+    Modbus::Response r;
+    uint16_t fact = 0;
+    uint8_t slave;
+    
+    if (!m_coalesced)
+        coalesce();
+    if (m_current == c_NoItem)
+    {
+        m_current = nextFrame();
+        if (m_current == c_NoItem) // there is no frame to poll now
+            return Modbus::OK;
+        m_start = millis();
+    }
+    h = &m_items[m_current];
+    slave = h->slave;
+    r = m_master->readData(h->func, slave, h->frameOffset, h->frameCount, m_buff, &fact);
+    if (r == Modbus::PROCESSING)
+        return r;
+    m_frames++;
+    m_current = c_NoItem;
+    h->frameLast = m_start;
+    complete(h, r, fact);
+    return r;
+}
+
+uint8_t ModbusPoller::nextFrame() const
+{
+    const ModbusPollItem* h;
+    ModbusPollChoice choice(millis());
+    uint8_t i;
+    
+    // the most overdue frame is polled first
+    for (i = 0; i < m_count; i++)
+    {
+        h = &m_items[i];
+        if (h->frameHead == i) // head of frame
+            choice.offer(i, h->frameLast, h->framePeriod);
+    }
+    return choice.index();
+}
+
+void ModbusPoller::complete(ModbusPollItem* head, Modbus::Response r, uint16_t fact)
+{
+    ModbusPollItem* it;
+    uint8_t i;
+    
+    // distribute frame data between items
+    for (i = head->frameHead; i != c_NoItem; i = it->frameNext)
+    {
+        it = &m_items[i];
+        if (r == Modbus::OK)
+        {
+            if (isBitsFunc(it->func))
+                it->status = read_bits(it->offset - head->frameOffset, m_buff, fact, it->data, it->count);
+            else if (it->offset - head->frameOffset + it->count <= fact)
+            {
+                memcpy(it->data, &m_buff[it->offset - head->frameOffset], it->count * sizeof(uint16_t));
+                it->status = Modbus::OK;
+            }
+            else
+                it->status = Modbus::CMN_ERR_NOT_CORRECT; // responsed less registers than requested
+            if (it->status == Modbus::OK)
+                it->time = m_start;
+        }
+        else
+            it->status = r;
+    }
+    // statistics of poll cycle
+    if (!head->frameCycle)
+    {
+        head->frameCycle = true;
+        m_cyclePolled++;
+    }
+    if (m_cyclePolled >= m_frameCount)
+    {
+        m_cycleTime = millis() - m_cycleStart;
+        m_cycleStart = millis();
+        m_cyclePolled = 0;
+        for (i = 0; i < m_count; i++)
+            m_items[i].frameCycle = false;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSPOLLER_H
+#define MODBUSPOLLER_H
+
+#include "ModbusMaster.h"
+
+// maximum count of registers in one frame of poller (FC3/FC4)
+#ifndef MODBUS_POLLER_MAX_REGS
+#define MODBUS_POLLER_MAX_REGS MB_MAX_READ_REGISTERS
+#endif
+
+// maximum count of bits in one frame of poller (FC1/FC2)
+#ifndef MODBUS_POLLER_MAX_BITS
+#define MODBUS_POLLER_MAX_BITS MB_MAX_READ_DISCRETS
+#endif
+
+// default count of registers/bits between items that are read to merge items into one frame
+#ifndef MODBUS_POLLER_REGS_GAP
+#define MODBUS_POLLER_REGS_GAP 4
+#endif
+
+#ifndef MODBUS_POLLER_BITS_GAP
+#define MODBUS_POLLER_BITS_GAP 32
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- MODBUS POLL ITEM -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+struct ModbusPollItem
+{
+    uint8_t slave;              // slave address
+    uint8_t func;               // MBF_READ_COIL_STATUS, MBF_READ_INPUT_STATUS, MBF_READ_HOLDING_REGISTERS or MBF_READ_INPUT_REGISTERS
+    uint16_t offset;            // offset of first bit/register
+    uint16_t count;             // count of bits/registers
+    unsigned long period;       // poll period in milliseconds (0 - as often as possible)
+    void* data;                 // buffer for bits (FC1, FC2) or uint16_t values (FC3, FC4)
+    Modbus::Response status;    // result of last poll (Modbus::PROCESSING - item was not polled yet)
+    unsigned long time;         // time (millis) of last successful poll
+    // used by ModbusPoller
+    uint8_t frameHead;          // index of item that keeps frame of this item
+    uint8_t frameNext;          // index of next item of the same frame
+    uint16_t frameOffset;       // for the head item: offset of frame
+    uint16_t frameCount;        // for the head item: count of bits/registers of frame
+    unsigned long framePeriod;  // for the head item: period of frame (minimal period of frame items)
+    unsigned long frameLast;    // for the head item: time when frame was polled last time
+    bool frameCycle;            // for the head item: frame was polled in current cycle
+};
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- MODBUS POLL CHOICE ---------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Chooses periodic item that must be polled next: every item is offered with time (millis) of its last poll
+// and its period, 'index' is the most overdue of items which period is elapsed (MODBUS_POLL_NONE - nothing to poll)
+#define MODBUS_POLL_NONE 0xFF
+
+class ModbusPollChoice
+{
+public:
+    ModbusPollChoice(unsigned long now) : m_now(now), m_overdue(0), m_index(MODBUS_POLL_NONE) {}
+
+public:
+    inline uint8_t index() const { return m_index; }
+    void offer(uint8_t index, unsigned long last, unsigned long period);
+
+private:
+    unsigned long m_now;
+    unsigned long m_overdue;
+    uint8_t m_index;
+};
+
+// --------------------------------------------------------------------------------------------------------
+// ----------------------------------------------- MODBUS POLLER ------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// Polls list of items periodically through any ModbusMaster (RTU or TCP) in non blocking mode.
+// Items with the same slave and function which ranges are adjacent or separated by not more than
+// 'regsGap'/'bitsGap' registers/bits are merged into one frame (up to MODBUS_POLLER_MAX_REGS registers or
+// MODBUS_POLLER_MAX_BITS bits). Registers between merged items are read too, so gap must be 0 for devices
+// that respond with exception on absent addresses.
+class ModbusPoller
+{
+public:
+    ModbusPoller(ModbusMaster* master, ModbusPollItem* items, uint8_t count);
+    
+public:
+    inline ModbusMaster* master() const { return m_master; }
+    inline ModbusPollItem* items() const { return m_items; }
+    inline uint8_t count() const { return m_count; }
+    inline uint16_t regsGap() const { return m_regsGap; }
+    inline void setRegsGap(uint16_t gap) { m_regsGap = gap; m_coalesced = false; }
+    inline uint16_t bitsGap() const { return m_bitsGap; }
+    inline void setBitsGap(uint16_t gap) { m_bitsGap = gap; m_coalesced = false; }
+    
+public: // statistics
+    inline uint8_t frameCount() const { return m_frameCount; } // count of frames in one poll cycle
+    inline uint32_t frames() const { return m_frames; } // count of frames that was sent
+    inline unsigned long cycleTime() const { return m_cycleTime; } // time of last cycle when every frame was polled
+    
+public:
+    void coalesce();
+    Modbus::Response exec();
+
+public:
+    static inline bool isBitsFunc(uint8_t func) { return (func == MBF_READ_COIL_STATUS) || (func == MBF_READ_INPUT_STATUS); }
+    static inline bool isRegsFunc(uint8_t func) { return (func == MBF_READ_HOLDING_REGISTERS) || (func == MBF_READ_INPUT_REGISTERS); }
+    
+private:
+    uint8_t nextFrame() const;
+    void complete(ModbusPollItem* head, Modbus::Response r, uint16_t fact);
+    
+private:
+    ModbusMaster* m_master;
+    ModbusPollItem* m_items;
+    uint8_t m_count;
+    uint16_t m_regsGap;
+    uint16_t m_bitsGap;
+    bool m_coalesced;
+    uint8_t m_current;
+    unsigned long m_start;
+    uint8_t m_frameCount;
+    uint8_t m_cyclePolled;
+    unsigned long m_cycleStart;
+    unsigned long m_cycleTime;
+    uint32_t m_frames;
+    uint16_t m_buff[(MODBUS_POLLER_MAX_BITS+15)/16 > MODBUS_POLLER_MAX_REGS ? (MODBUS_POLLER_MAX_BITS+15)/16 : MODBUS_POLLER_MAX_REGS];
+};
+
+#endif // MODBUSPOLLER_H
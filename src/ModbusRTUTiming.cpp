@@ -0,0 +1,70 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusRTUTiming.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// -------------------------------------------- MODBUS RTU TIMING -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusRTUTiming::ModbusRTUTiming(unsigned long baudRate, uint8_t charBits, ModbusClockUs clock)
+{
+    setClock(clock);
+    setLine(baudRate, charBits);
+}
+
+void ModbusRTUTiming::setClock(ModbusClockUs clock)
+{
+    m_clock = clock ? clock : micros;
+}
+
+void ModbusRTUTiming::setLine(unsigned long baudRate, uint8_t charBits)
+{
+    m_baudRate = baudRate ? baudRate : 1;
+    m_charBits = charBits;
+    m_char = (static_cast<unsigned long>(charBits)*1000000UL+m_baudRate-1)/m_baudRate; // rounded up
+    if (m_baudRate > MB_RTU_FIXED_TIMING_BAUD)
+    {
+        m_t15 = MB_RTU_FIXED_T15_US;
+        m_t35 = MB_RTU_FIXED_T35_US;
+    }
+    else
+    {
+        m_t15 = (m_char*3+1)/2;
+        m_t35 = (m_char*7+1)/2;
+    }
+}
+
+unsigned long ModbusRTUTiming::lineTime(const ModbusRTUTiming* timing)
+{
+    return timing ? timing->now() : millis();
+}
+
+bool ModbusRTUTiming::isLineSilent(const ModbusRTUTiming* timing, unsigned long lastByte, unsigned long timeoutIB)
+{
+    if (timing)
+        return timing->isSilent(lastByte);
+    return millis()-lastByte >= timeoutIB;
+}
@@ -0,0 +1,85 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSRTUTIMING_H
+#define MODBUSRTUTIMING_H
+
+#include "Modbus.h"
+
+// count of bits of one RTU character: start(1) + data(8) + parity(1) + stop(1)
+// (or start + data + 2 stop bits without parity)
+#define MB_RTU_CHAR_SZ_BITS 11
+
+// baud rate above which t1.5 and t3.5 have fixed values by Modbus specification
+#define MB_RTU_FIXED_TIMING_BAUD 19200
+
+// fixed t1.5 and t3.5 values (microseconds) for baud rates above MB_RTU_FIXED_TIMING_BAUD
+#define MB_RTU_FIXED_T15_US 750
+#define MB_RTU_FIXED_T35_US 1750
+
+// microsecond clock (Arduino 'micros' is used if clock is not set)
+typedef unsigned long (*ModbusClockUs)();
+
+// --------------------------------------------------------------------------------------------------------
+// -------------------------------------------- MODBUS RTU TIMING -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusRTUTiming keeps inter-character (t1.5) and inter-frame (t3.5) silence intervals of RTU line
+    derived from its baud rate and character format. It's set to ModbusMasterRTU/ModbusSlaveIORTU
+    by 'setTiming' and then end of frame is detected after t3.5 silence measured by microsecond clock
+    instead of millisecond 'timeoutInterByte'. One timing object can be shared by several masters/slaves.
+*/
+class ModbusRTUTiming
+{
+public:
+    ModbusRTUTiming(unsigned long baudRate, uint8_t charBits = MB_RTU_CHAR_SZ_BITS, ModbusClockUs clock = MB_NULLPTR);
+
+public:
+    inline unsigned long baudRate() const { return m_baudRate; }
+    inline uint8_t charBits() const { return m_charBits; }
+    void setLine(unsigned long baudRate, uint8_t charBits = MB_RTU_CHAR_SZ_BITS);
+    inline ModbusClockUs clock() const { return m_clock; }
+    void setClock(ModbusClockUs clock);
+    inline unsigned long now() const { return m_clock(); }
+    inline unsigned long charTime() const { return m_char; }
+    inline unsigned long t15() const { return m_t15; }
+    inline unsigned long t35() const { return m_t35; }
+    inline bool isSilent(unsigned long lastByte) const { return m_clock()-lastByte >= m_t35; }
+
+public:
+    // time for inter-byte silence measurement: microseconds of 'timing' if it's set, otherwise milliseconds
+    static unsigned long lineTime(const ModbusRTUTiming* timing);
+    // t3.5 silence of 'timing' (or 'timeoutIB' milliseconds if it's not set) elapsed since 'lastByte' received at 'lineTime'
+    static bool isLineSilent(const ModbusRTUTiming* timing, unsigned long lastByte, unsigned long timeoutIB);
+
+private:
+    unsigned long m_baudRate;
+    uint8_t m_charBits;
+    ModbusClockUs m_clock;
+    unsigned long m_char;   // time of one character (microseconds)
+    unsigned long m_t15;    // inter-character silence (microseconds)
+    unsigned long m_t35;    // inter-frame silence (microseconds)
+};
+
+#endif // MODBUSRTUTIMING_H
@@ -0,0 +1,160 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusScheduler.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- MODBUS SCHEDULER -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusScheduler::ModbusScheduler(ModbusMaster* master)
+{
+    m_master = master;
+    m_queue = MB_NULLPTR;
+    m_queued = 0;
+    m_deadline[PRIORITY_COMMAND] = MODBUS_SCHEDULER_DEADLINE_COMMAND;
+    m_deadline[PRIORITY_ALARM] = MODBUS_SCHEDULER_DEADLINE_ALARM;
+    m_deadline[PRIORITY_TREND] = MODBUS_SCHEDULER_DEADLINE_TREND;
+    m_starvation = MODBUS_SCHEDULER_STARVATION;
+    resetMetrics();
+}
+
+void ModbusScheduler::resetMetrics()
+{
+    for (uint8_t i = 0; i < PRIORITY_COUNT; i++)
+    {
+        m_started[i] = 0;
+        m_missed[i] = 0;
+        m_delayLast[i] = 0;
+        m_delayMax[i] = 0;
+        m_delaySum[i] = 0;
+    }
+}
+
+// Adds request to scheduler. Returns false if request is already in process or its priority is wrong.
+bool ModbusScheduler::submit(ModbusRequest* request)
+{
+    const ModbusRequest* q;
+
+    if ((request->priority >= PRIORITY_COUNT) || m_master->isQueued(request))
+        return false;
+    for (q = m_queue; q; q = q->next)
+    {
+        if (q == request)
+            return false;
+    }
+    request->status = Modbus::PROCESSING;
+    request->fact = 0;
+    request->time = millis();
+    request->next = m_queue;
+    m_queue = request;
+    m_queued++;
+    return true;
+}
+
+// Removes request that is waiting for master. Request that was passed to master can't be canceled.
+bool ModbusScheduler::cancel(ModbusRequest* request)
+{
+    ModbusRequest** p;
+
+    for (p = &m_queue; *p; p = &(*p)->next)
+    {
+        if (*p == request)
+        {
+            *p = request->next;
+            m_queued--;
+            request->status = Modbus::CMN_ERR_CANCELED;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModbusScheduler::poll()
+{
+    ModbusRequest* q;
+    ModbusRequest** p;
+    unsigned long now, delay;
+    uint8_t c;
+
+    if (!m_master->queued() && m_queue) // master is free: start the most urgent request
+    {
+        now = millis();
+        q = next(now);
+        for (p = &m_queue; *p != q; p = &(*p)->next);
+        *p = q->next;
+        m_queued--;
+        c = q->priority;
+        delay = now - q->time;
+        m_started[c]++;
+        m_delayLast[c] = delay;
+        m_delaySum[c] += delay;
+        if (delay > m_delayMax[c])
+            m_delayMax[c] = delay;
+        if (delay > deadlineOf(q))
+            m_missed[c]++;
+        m_master->submit(q);
+    }
+    m_master->poll();
+}
+
+// The most urgent request: starving one with the earliest deadline, otherwise request of the highest class
+// with the earliest deadline
+ModbusRequest* ModbusScheduler::next(unsigned long now) const
+{
+    ModbusRequest *q, *best = MB_NULLPTR;
+    unsigned long dl, bestDl = 0;
+    bool starving, bestStarving = false;
+
+    for (q = m_queue; q; q = q->next)
+    {
+        dl = q->time + deadlineOf(q);
+        starving = static_cast<long>(now - dl) >= static_cast<long>(m_starvation);
+        if (best)
+        {
+            if (starving != bestStarving)
+            {
+                if (!starving)
+                    continue;
+            }
+            else if (!starving && (q->priority != best->priority))
+            {
+                if (q->priority > best->priority)
+                    continue;
+            }
+            else if (static_cast<long>(dl - bestDl) > 0) // list is in reverse order of submission: older request wins tie
+                continue;
+        }
+        best = q;
+        bestDl = dl;
+        bestStarving = starving;
+    }
+    return best;
+}
+
+unsigned long ModbusScheduler::deadlineOf(const ModbusRequest* request) const
+{
+    return request->deadline ? request->deadline : m_deadline[request->priority];
+}
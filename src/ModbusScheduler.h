@@ -0,0 +1,113 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSSCHEDULER_H
+#define MODBUSSCHEDULER_H
+
+#include "ModbusMaster.h"
+
+// default deadlines of priority classes (milliseconds after submission)
+#ifndef MODBUS_SCHEDULER_DEADLINE_COMMAND
+#define MODBUS_SCHEDULER_DEADLINE_COMMAND 100
+#endif
+
+#ifndef MODBUS_SCHEDULER_DEADLINE_ALARM
+#define MODBUS_SCHEDULER_DEADLINE_ALARM 500
+#endif
+
+#ifndef MODBUS_SCHEDULER_DEADLINE_TREND
+#define MODBUS_SCHEDULER_DEADLINE_TREND 5000
+#endif
+
+// default time (milliseconds) after missed deadline when request is executed before requests of higher classes
+#ifndef MODBUS_SCHEDULER_STARVATION
+#define MODBUS_SCHEDULER_STARVATION 2000
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- MODBUS SCHEDULER -----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusScheduler orders requests (ModbusRequest) to one master (e.g. ModbusMasterRTU on half-duplex line).
+    Request of higher priority class (command > alarm poll > trend poll) is executed first, requests of the same
+    class are executed in order of their deadlines (earliest deadline first). Request which deadline is missed
+    more than 'starvationTime' is executed before any other request (so low class isn't starved by high ones).
+    Next request is chosen only when master is free, so command submitted during transaction is sent right after it.
+    Completed request is returned through its callback by master. Call 'poll' in loop instead of master's 'poll'.
+    Metrics of every class: count of started requests, queueing delay (time from submission to start of request)
+    and count of requests started after deadline.
+*/
+class ModbusScheduler
+{
+public:
+    enum Priority
+    {
+        PRIORITY_COMMAND    ,   // operator commands (writes)
+        PRIORITY_ALARM      ,   // alarm polls
+        PRIORITY_TREND      ,   // trend polls
+        PRIORITY_COUNT
+    };
+
+public:
+    ModbusScheduler(ModbusMaster* master);
+
+public:
+    inline ModbusMaster* master() const { return m_master; }
+    inline unsigned long defaultDeadline(uint8_t priority) const { return m_deadline[priority]; }
+    inline void setDefaultDeadline(uint8_t priority, unsigned long deadline) { m_deadline[priority] = deadline; }
+    inline unsigned long starvationTime() const { return m_starvation; }
+    inline void setStarvationTime(unsigned long time) { m_starvation = time; }
+    inline uint8_t queued() const { return m_queued; }
+
+public:
+    bool submit(ModbusRequest* request);
+    bool cancel(ModbusRequest* request);
+    void poll();
+
+public: // metrics of priority class
+    inline uint32_t started(uint8_t priority) const { return m_started[priority]; }
+    inline uint32_t missed(uint8_t priority) const { return m_missed[priority]; }
+    inline unsigned long delayLast(uint8_t priority) const { return m_delayLast[priority]; }
+    inline unsigned long delayMax(uint8_t priority) const { return m_delayMax[priority]; }
+    inline unsigned long delayAvg(uint8_t priority) const { return m_started[priority] ? m_delaySum[priority] / m_started[priority] : 0; }
+    void resetMetrics();
+
+private:
+    ModbusRequest* next(unsigned long now) const;
+    unsigned long deadlineOf(const ModbusRequest* request) const;
+
+private:
+    ModbusMaster* m_master;
+    ModbusRequest* m_queue;     // list of requests waiting for master (unordered)
+    uint8_t m_queued;
+    unsigned long m_deadline[PRIORITY_COUNT];
+    unsigned long m_starvation;
+    uint32_t m_started[PRIORITY_COUNT];
+    uint32_t m_missed[PRIORITY_COUNT];
+    unsigned long m_delayLast[PRIORITY_COUNT];
+    unsigned long m_delayMax[PRIORITY_COUNT];
+    unsigned long m_delaySum[PRIORITY_COUNT];
+};
+
+#endif // MODBUSSCHEDULER_H
@@ -177,6 +177,38 @@ Modbus::Response ModbusSlave::exec()
                 if (m_memCount > MB_MAX_REGISTERS) // prevent memBuff overflow 
                     m_memCount = MB_MAX_REGISTERS; 
                 break;
+            case MBF_MASK_WRITE_4X_REGISTER:
+                if (outBytes != 6) // not correct request from master - don't respond
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                m_memOffset = bufferByteAt(1) | (bufferByteAt(0)<<8);
+                getBufferBytesAt(2, m_memBuff, 4); // AND mask and OR mask
+                break;
+            case MBF_READ_WRITE_4X_REGISTER: // Read/Write multiple registers
+                if (outBytes < 9) // not correct request from master - don't respond
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                if (outBytes != bufferByteAt(8)+9) // don't match readed bytes and number of data bytes to follow
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                m_memOffset = bufferByteAt(1) | (bufferByteAt(0)<<8);
+                m_memCount = bufferByteAt(3) | (bufferByteAt(2)<<8);
+                m_memWriteOffset = bufferByteAt(5) | (bufferByteAt(4)<<8);
+                m_memWriteCount = bufferByteAt(7) | (bufferByteAt(6)<<8);
+                if (m_memWriteCount*2 != bufferByteAt(8)) // don't match count values and bytes
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                if (m_memCount > MB_MAX_REGISTERS) // prevent valueBuff overflow 
+                    m_memCount = MB_MAX_REGISTERS;
+                break;
             default:
                 r = Modbus::ILLEGAL_FUNCTION;
                 break;
@@ -192,7 +224,7 @@ Modbus::Response ModbusSlave::exec()
             {
             case MBF_READ_COIL_STATUS:
                 outCount = 0;
-                c = (m_memCount+7/8); // count bytes needed
+                c = (m_memCount+7)/8; // count bytes needed
                 c = (c+MBSLAVEMEM_BUFF_SZ_BYTES-1)/MBSLAVEMEM_BUFF_SZ_BYTES;
                 for (i = 0; i < c; i++)
                 {
@@ -211,7 +243,7 @@ Modbus::Response ModbusSlave::exec()
                 break;
             case MBF_READ_INPUT_STATUS:
                 outCount = 0;
-                c = (m_memCount+7/8); // count bytes needed
+                c = (m_memCount+7)/8; // count bytes needed
                 c = (c+MBSLAVEMEM_BUFF_SZ_BYTES-1)/MBSLAVEMEM_BUFF_SZ_BYTES; // count cycles
                 for (i = 0; i < c; i++)
                 {
@@ -230,53 +262,11 @@ Modbus::Response ModbusSlave::exec()
                 break;
             case MBF_READ_HOLDING_REGISTERS:
                 outCount = 0;
-                c = (m_memCount+MBSLAVEMEM_BUFF_SZ_REGES-1)/MBSLAVEMEM_BUFF_SZ_REGES; // count cycles
-                for (i = 0; i < c; i++)
-                {
-                    uint16_t cn = m_memCount >= (i+1)*MBSLAVEMEM_BUFF_SZ_REGES ? MBSLAVEMEM_BUFF_SZ_REGES : m_memCount%MBSLAVEMEM_BUFF_SZ_REGES;
-                    r = m_memory->readHoldingRegisters(m_memSlave, m_memOffset+i*MBSLAVEMEM_BUFF_SZ_REGES, cn, reinterpret_cast<uint16_t*>(m_memBuff), &cn);
-                    if (r)
-                    {
-                        // when returns illegal address not in first cycle - it's normal
-                        if (r == Modbus::ILLEGAL_DATA_ADDRESS && i > 0)
-                            r = Modbus::OK;
-                        break;
-                    }
-                    for (int j = 1; j < MBSLAVEMEM_BUFF_SZ_BYTES; j+=2)
-                    {
-                        // exchange values of near bytes
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j-1] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                    }
-                    setBufferBytesAt(1+i*MBSLAVEMEM_BUFF_SZ_REGES, m_memBuff, cn*2);
-                    outCount += cn;
-                } 
+                r = m_memory->readHoldingRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), &outCount);
                 break;
             case MBF_READ_INPUT_REGISTERS:
                 outCount = 0;
-                c = (m_memCount+MBSLAVEMEM_BUFF_SZ_REGES-1)/MBSLAVEMEM_BUFF_SZ_REGES; // count cycles
-                for (i = 0; i < c; i++)
-                {
-                    uint16_t cn = m_memCount >= (i+1)*MBSLAVEMEM_BUFF_SZ_REGES ? MBSLAVEMEM_BUFF_SZ_REGES : m_memCount%MBSLAVEMEM_BUFF_SZ_REGES;
-                    r = m_memory->readInputRegisters(m_memSlave, m_memOffset+i*MBSLAVEMEM_BUFF_SZ_REGES, cn, reinterpret_cast<uint16_t*>(m_memBuff), &cn);
-                    if (r)
-                    {
-                        // when returns illegal address not in first cycle - it's normal
-                        if (r == Modbus::ILLEGAL_DATA_ADDRESS && i > 0)
-                            r = Modbus::OK;
-                        break;
-                    }
-                    for (int j = 1; j < MBSLAVEMEM_BUFF_SZ_BYTES; j+=2)
-                    {
-                        // exchange values of near bytes
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j-1] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                    }
-                    setBufferBytesAt(1+i*MBSLAVEMEM_BUFF_SZ_REGES, m_memBuff, cn*2);
-                    outCount += cn;
-                } 
+                r = m_memory->readInputRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), &outCount);
                 break;
             case MBF_FORCE_SINGLE_COIL:
                 m_memBuff[0] = bufferByteAt(2);
@@ -289,12 +279,12 @@ Modbus::Response ModbusSlave::exec()
                 break;          
             case MBF_FORCE_MULTIPLE_COILS:
                 outCount = 0;
-                c = (m_memCount+7/8); // count bytes needed
+                c = (m_memCount+7)/8; // count bytes needed
                 c = (c+MBSLAVEMEM_BUFF_SZ_BYTES-1)/MBSLAVEMEM_BUFF_SZ_BYTES;
                 for (i = 0; i < c; i++)
                 {
                     uint16_t cn = m_memCount >= (i+1)*MBSLAVEMEM_BUFF_SZ_BITES ? MBSLAVEMEM_BUFF_SZ_BITES : m_memCount%MBSLAVEMEM_BUFF_SZ_BITES;
-                    getBufferBytesAt(5+i*MBSLAVEMEM_BUFF_SZ_BYTES, m_memBuff, cn);
+                    getBufferBytesAt(5+i*MBSLAVEMEM_BUFF_SZ_BYTES, m_memBuff, (cn+7)/8);
                     r = m_memory->forceMultipleCoils(m_memSlave, m_memOffset+i*MBSLAVEMEM_BUFF_SZ_BITES, cn, m_memBuff, &cn);
                     if (r)
                     {
@@ -312,14 +302,7 @@ Modbus::Response ModbusSlave::exec()
                 for (i = 0; i < c; i++)
                 {
                     uint16_t cn = m_memCount >= (i+1)*MBSLAVEMEM_BUFF_SZ_REGES ? MBSLAVEMEM_BUFF_SZ_REGES : m_memCount%MBSLAVEMEM_BUFF_SZ_REGES;
-                    getBufferBytesAt(5+i*MBSLAVEMEM_BUFF_SZ_BYTES, m_memBuff, cn*2);
-                    for (int j = 1; j < MBSLAVEMEM_BUFF_SZ_BYTES; j+=2)
-                    {
-                        // exchange values of near bytes
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j-1] = m_memBuff[j-1]^m_memBuff[j];
-                        m_memBuff[j] = m_memBuff[j-1]^m_memBuff[j];
-                    }
+                    Modbus::getRegsBE(bufferData(5+i*MBSLAVEMEM_BUFF_SZ_BYTES), cn, reinterpret_cast<uint16_t*>(m_memBuff));
                     r = m_memory->forceMultipleRegisters(m_memSlave, m_memOffset+i*MBSLAVEMEM_BUFF_SZ_REGES, cn, reinterpret_cast<uint16_t*>(m_memBuff), &cn);
                     if (r)
                     {
@@ -331,6 +314,13 @@ Modbus::Response ModbusSlave::exec()
                     outCount += cn;
                 } 
                 break;
+            case MBF_MASK_WRITE_4X_REGISTER:
+                r = m_memory->maskWriteRegister(m_memSlave, m_memOffset, m_memBuff[1] | (m_memBuff[0]<<8), m_memBuff[3] | (m_memBuff[2]<<8));
+                break;
+            case MBF_READ_WRITE_4X_REGISTER:
+                outCount = 0;
+                r = m_memory->readWriteMultipleRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), m_memWriteOffset, m_memWriteCount, bufferData(9), &outCount);
+                break;
             }
             if (r < Modbus::OK) // processing
                 break;
@@ -355,6 +345,7 @@ Modbus::Response ModbusSlave::exec()
                     break;
                 case MBF_READ_HOLDING_REGISTERS:
                 case MBF_READ_INPUT_REGISTERS:
+                case MBF_READ_WRITE_4X_REGISTER:
                     outCount = outCount*2;
                     setBufferByteAt(0, static_cast<uint8_t>(outCount)); // count next bytes
                     outCount += 1;
@@ -373,6 +364,12 @@ Modbus::Response ModbusSlave::exec()
                     setBufferByteAt(3, m_memBuff[0]);                           // value (Lo-byte)
                     outCount = 4;
                     break;          
+                case MBF_MASK_WRITE_4X_REGISTER:
+                    setBufferByteAt(0, static_cast<uint8_t>(m_memOffset>>8));   // address of register (Hi-byte)
+                    setBufferByteAt(1, static_cast<uint8_t>(m_memOffset&0xFF)); // address of register (Lo-byte)
+                    setBufferBytesAt(2, m_memBuff, 4);                          // AND mask and OR mask
+                    outCount = 6;
+                    break;
                 case MBF_FORCE_MULTIPLE_COILS:
                 case MBF_FORCE_MULTIPLE_REGISTERS:
                     setBufferByteAt(0, static_cast<uint8_t>(m_memOffset>>8));   // address of written values (Hi-byte)
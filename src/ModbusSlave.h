@@ -58,6 +58,8 @@ private:
     uint8_t m_memFunc;
     uint16_t m_memOffset;
     uint16_t m_memCount;
+    uint16_t m_memWriteOffset;
+    uint16_t m_memWriteCount;
     uint8_t m_memBuff[MBSLAVEMEM_BUFF_SZ_BYTES];
 };
 
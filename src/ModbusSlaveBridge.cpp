@@ -39,7 +39,7 @@ bool ModbusSlaveBridge::slaveCheck(uint8_t &/*slave*/) const
 Modbus::Response ModbusSlaveBridge::exec()
 {
     Modbus::Response r = Modbus::OK;
-    uint16_t outBytes, outCount, i;
+    uint16_t outBytes, outCount;
     bool fRepeatAgain;
     
     do
@@ -174,11 +174,39 @@ Modbus::Response ModbusSlaveBridge::exec()
                 }
                 if (m_memCount > MB_MAX_REGISTERS) // prevent memBuff overflow 
                     m_memCount = MB_MAX_REGISTERS; 
-                for (i = 0; i < m_memCount; i++)
+                Modbus::getRegsBE(bufferData(5), m_memCount, reinterpret_cast<uint16_t*>(m_memBuff));
+                break;
+            case MBF_MASK_WRITE_4X_REGISTER:
+                if (outBytes != 6) // not correct request from master - don't respond
                 {
-                    m_memBuff[i*2]   = bufferByteAt(6+i*2);
-                    m_memBuff[i*2+1] = bufferByteAt(5+i*2);
-                }            
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                m_memOffset = bufferByteAt(1) | (bufferByteAt(0)<<8);
+                getBufferBytesAt(2, m_memBuff, 4); // AND mask and OR mask
+                break;
+            case MBF_READ_WRITE_4X_REGISTER: // Read/Write multiple registers
+                if (outBytes < 9) // not correct request from master - don't respond
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                if (outBytes != bufferByteAt(8)+9) // don't match readed bytes and number of data bytes to follow
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                m_memOffset = bufferByteAt(1) | (bufferByteAt(0)<<8);
+                m_memCount = bufferByteAt(3) | (bufferByteAt(2)<<8);
+                m_memWriteOffset = bufferByteAt(5) | (bufferByteAt(4)<<8);
+                m_memWriteCount = bufferByteAt(7) | (bufferByteAt(6)<<8);
+                if (m_memWriteCount*2 != bufferByteAt(8)) // don't match count values and bytes
+                {
+                    m_state = STATE_BEGIN_READ;
+                    return Modbus::CMN_ERR_NOT_CORRECT;
+                }
+                if (m_memCount > MB_MAX_REGISTERS) // prevent valueBuff overflow 
+                    m_memCount = MB_MAX_REGISTERS;
                 break;
             default:
                 r = Modbus::ILLEGAL_FUNCTION;
@@ -200,10 +228,10 @@ Modbus::Response ModbusSlaveBridge::exec()
                 r = m_device->readInputStatus(m_memSlave, m_memOffset, m_memCount, m_memBuff, &outCount);
                 break;
             case MBF_READ_HOLDING_REGISTERS:
-                r = m_device->readHoldingRegisters(m_memSlave, m_memOffset, m_memCount, reinterpret_cast<uint16_t*>(m_memBuff), &outCount);
+                r = m_device->readHoldingRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), &outCount);
                 break;
             case MBF_READ_INPUT_REGISTERS:
-                r = m_device->readInputRegisters(m_memSlave, m_memOffset, m_memCount, reinterpret_cast<uint16_t*>(m_memBuff), &outCount);
+                r = m_device->readInputRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), &outCount);
                 break;
             case MBF_FORCE_SINGLE_COIL:
                 r = m_device->forceSingleCoil(m_memSlave, m_memOffset, m_memBuff[0]);
@@ -217,6 +245,12 @@ Modbus::Response ModbusSlaveBridge::exec()
             case MBF_FORCE_MULTIPLE_REGISTERS:
                 r = m_device->forceMultipleRegisters(m_memSlave, m_memOffset, m_memCount, reinterpret_cast<uint16_t*>(m_memBuff), &outCount);
                 break;
+            case MBF_MASK_WRITE_4X_REGISTER:
+                r = m_device->maskWriteRegister(m_memSlave, m_memOffset, m_memBuff[1] | (m_memBuff[0]<<8), m_memBuff[3] | (m_memBuff[2]<<8));
+                break;
+            case MBF_READ_WRITE_4X_REGISTER:
+                r = m_device->readWriteMultipleRegistersBE(m_memSlave, m_memOffset, m_memCount, bufferData(1), m_memWriteOffset, m_memWriteCount, bufferData(9), &outCount);
+                break;
             }
             if (r < Modbus::OK) // processing
                 break;
@@ -242,11 +276,7 @@ Modbus::Response ModbusSlaveBridge::exec()
                     break;
                 case MBF_READ_HOLDING_REGISTERS:
                 case MBF_READ_INPUT_REGISTERS:
-                    for (i = 0; i < outCount; i++)
-                    {
-                        setBufferByteAt(2+i*2, m_memBuff[i*2]);
-                        setBufferByteAt(1+i*2, m_memBuff[i*2+1]);
-                    }
+                case MBF_READ_WRITE_4X_REGISTER:
                     outCount = outCount*2;
                     setBufferByteAt(0, static_cast<uint8_t>(outCount)); // count next bytes
                     outCount += 1;
@@ -265,6 +295,12 @@ Modbus::Response ModbusSlaveBridge::exec()
                     setBufferByteAt(3, m_memBuff[0]);                           // value (Lo-byte)
                     outCount = 4;
                     break;          
+                case MBF_MASK_WRITE_4X_REGISTER:
+                    setBufferByteAt(0, static_cast<uint8_t>(m_memOffset>>8));   // address of register (Hi-byte)
+                    setBufferByteAt(1, static_cast<uint8_t>(m_memOffset&0xFF)); // address of register (Lo-byte)
+                    setBufferBytesAt(2, m_memBuff, 4);                          // AND mask and OR mask
+                    outCount = 6;
+                    break;
                 case MBF_FORCE_MULTIPLE_COILS:
                 case MBF_FORCE_MULTIPLE_REGISTERS:
                     setBufferByteAt(0, static_cast<uint8_t>(m_memOffset>>8));   // address of written values (Hi-byte)
@@ -67,6 +67,7 @@ protected: // buffer control interface
     virtual void setBufferByteAt(uint16_t offset, uint8_t value) = 0;
     inline void setBufferByte(uint16_t offset, uint8_t value) { if (offset < bufferSize()) setBufferByteAt(offset, value); }
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count) = 0;
+    virtual uint8_t* bufferData(uint16_t offset) = 0; // direct pointer to buffer bytes started from 'offset'
 
 protected: // IO interface
     virtual Modbus::Response begin() = 0;
@@ -22,6 +22,7 @@
 */
 
 #include "ModbusSlaveIORTU.h"
+#include "ModbusRTUTiming.h"
 
 #include <Arduino.h>
 
@@ -38,10 +39,42 @@ static const uint16_t c_HiLevBuffSzDiff = c_HiLevBuffOffset+2;
 // high level buffer size
 static const uint16_t c_HiLevBuffSz = MB_RTU_IO_BUFF_SZ-c_HiLevBuffSzDiff; 
 
+// Returns size of RTU request frame (with crc) which first 'sz' bytes are in 'buff'
+// or 0 if size is unknown yet (or unknown for this function at all)
+static uint16_t requestSize(const uint8_t* buff, uint16_t sz)
+{
+    if (sz < 2)
+        return 0;
+    switch (buff[1])
+    {
+    case MBF_READ_COIL_STATUS:
+    case MBF_READ_INPUT_STATUS:
+    case MBF_READ_HOLDING_REGISTERS:
+    case MBF_READ_INPUT_REGISTERS:
+    case MBF_FORCE_SINGLE_COIL:
+    case MBF_FORCE_SINGLE_REGISTER:
+        return 8; // slave(1), function(1), offset(2), count or value(2), crc(2)
+    case MBF_FORCE_MULTIPLE_COILS:
+    case MBF_FORCE_MULTIPLE_REGISTERS:
+        if (sz < 7)
+            return 0;
+        return 9+buff[6]; // slave(1), function(1), offset(2), count(2), count of bytes(1), data, crc(2)
+    case MBF_MASK_WRITE_4X_REGISTER:
+        return 10; // slave(1), function(1), offset(2), and mask(2), or mask(2), crc(2)
+    case MBF_READ_WRITE_4X_REGISTER:
+        if (sz < 11)
+            return 0;
+        return 13+buff[10]; // slave(1), function(1), read offset(2), read count(2), write offset(2), write count(2), count of bytes(1), data, crc(2)
+    default:
+        return 0;
+    }
+}
+
 ModbusSlaveIORTU::ModbusSlaveIORTU(Stream* stream) : ModbusSlaveIO()
 { 
     m_stream = stream;
     m_timeoutIB = 20;
+    m_timing = MB_NULLPTR;
 }
 
 uint16_t ModbusSlaveIORTU::bufferSize() const
@@ -69,13 +102,18 @@ void ModbusSlaveIORTU::setBufferBytesAt(uint16_t offset, const void *buff, uint1
     memcpy(&m_buff[c_HiLevBuffOffset+offset], buff, count);
 }
 
+uint8_t* ModbusSlaveIORTU::bufferData(uint16_t offset)
+{
+    return &m_buff[c_HiLevBuffOffset+offset];
+}
+
 Modbus::Response ModbusSlaveIORTU::begin()
 {
     return Modbus::OK;
 }
 Modbus::Response ModbusSlaveIORTU::read(uint8_t &slave, uint8_t &func, uint16_t &szBuff)
 {
-    uint16_t crc;
+    uint16_t c;
     bool fRepeatAgain;
 
     do
@@ -90,14 +128,20 @@ Modbus::Response ModbusSlaveIORTU::read(uint8_t &slave, uint8_t &func, uint16_t
                     m_buff[m_sz] = m_stream->read();
                 if ((m_sz >= MB_RTU_IO_BUFF_SZ) && m_stream->available())
                     return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
-                m_start = millis();
+                m_crc = Modbus::crc16_update(MB_CRC16_INIT, m_buff, m_sz); // rolling crc of received bytes
+                m_start = ModbusRTUTiming::lineTime(m_timing);
                 m_state = STATE_WAIT_FOR_READ_ALL;
+                fRepeatAgain = true; // check if frame is complete
             }
             break;
         case STATE_WAIT_FOR_READ_ALL:
-            if (m_stream->available()) // read next bytes
+            if ((m_sz == requestSize(m_buff, m_sz)) && !m_crc) // whole frame is received - no need to wait for silence
+            {
+                ; // go to input data processing
+            }
+            else if (m_stream->available()) // read next bytes
             {
-                for (; m_stream->available() && (m_sz < MB_RTU_IO_BUFF_SZ); m_sz++)
+                for (c = m_sz; m_stream->available() && (m_sz < MB_RTU_IO_BUFF_SZ); m_sz++)
                     m_buff[m_sz] = m_stream->read();
                 if ((m_sz >= MB_RTU_IO_BUFF_SZ) && m_stream->available())
                 {
@@ -106,10 +150,12 @@ Modbus::Response ModbusSlaveIORTU::read(uint8_t &slave, uint8_t &func, uint16_t
                         m_stream->read();
                     return Modbus::CMN_ERR_READ_BUFF_OVERFLOW;
                 }
-                m_start = millis();
+                m_crc = Modbus::crc16_update(m_crc, &m_buff[c], m_sz-c); // fold new bytes into rolling crc
+                m_start = ModbusRTUTiming::lineTime(m_timing);
+                fRepeatAgain = true; // check if frame is complete
                 break;
             }
-            else if (millis()-m_start >= m_timeoutIB) // waiting timeout elapsed - means that all data read
+            else if (ModbusRTUTiming::isLineSilent(m_timing, m_start, m_timeoutIB)) // waiting timeout elapsed - means that all data read (frame size is unknown or crc is wrong)
             {
                 ; // go to input data processing
             }
@@ -129,8 +175,7 @@ Modbus::Response ModbusSlaveIORTU::read(uint8_t &slave, uint8_t &func, uint16_t
             if (m_sz < 4) // minimum size of message 4 = 1 byte(slave)+1 byte(func)+2 byte(CRC)
                 return Modbus::CMN_ERR_NOT_CORRECT; // Not correct response. Responsed data length to small
         
-            crc = m_buff[m_sz-2] | (m_buff[m_sz-1] << 8);
-            if (Modbus::crc16(m_buff, m_sz-2) != crc)
+            if (m_crc) // crc of whole frame including its own crc-bytes must be zero
                 return Modbus::RTU_ERR_CRC; // Wrong crc
             slave = m_buff[0];
             func = m_buff[1];
@@ -146,6 +191,8 @@ Modbus::Response ModbusSlaveIORTU::write(uint8_t slave, uint8_t func, uint16_t s
 {
     uint16_t crc;
     
+    if (Modbus::isBroadcast(m_buff[0], func & ~MBF_EXCEPTION)) // m_buff[0] is still slave address of request
+        return Modbus::OK; // don't respond to broadcast
     if (szBuff > c_HiLevBuffSz) // crc size in bytes is 2
         return Modbus::CMN_ERR_WRITE_BUFF_OVERFLOW;
     m_buff[0] = slave; 
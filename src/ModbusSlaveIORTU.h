@@ -27,6 +27,7 @@
 #include "ModbusSlaveIO.h"
 
 class Stream;
+class ModbusRTUTiming;
 
 // --------------------------------------------------------------------------------------------------------
 // ------------------------------------------ MODBUS SLAVE IO RTU -----------------------------------------
@@ -45,6 +46,8 @@ public:
     inline void setStream(Stream *stream) { m_stream = stream; }
     inline unsigned long timeoutInterByte() const { return m_timeoutIB; }
     inline void setTimeoutInterByte(unsigned long timeout) { m_timeoutIB = timeout; }
+    inline const ModbusRTUTiming* timing() const { return m_timing; }
+    inline void setTiming(const ModbusRTUTiming* timing) { m_timing = timing; } // NULL - use 'timeoutInterByte'
 
 protected: // buffer control interface
     virtual uint16_t bufferSize() const;
@@ -52,6 +55,7 @@ protected: // buffer control interface
     virtual void getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const;
     virtual void setBufferByteAt(uint16_t offset, uint8_t value);
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count);
+    virtual uint8_t* bufferData(uint16_t offset);
 
 protected: // IO interface
     virtual Modbus::Response begin();
@@ -61,8 +65,10 @@ protected: // IO interface
 private:
     Stream* m_stream;
     unsigned long m_timeoutIB;
+    const ModbusRTUTiming* m_timing;
     uint8_t m_buff[MB_RTU_IO_BUFF_SZ];
     uint16_t m_sz;
+    uint16_t m_crc;
 };
 
 #endif // MODBUSSLAVEIORTU_H
@@ -82,6 +82,11 @@ void ModbusSlaveIOTCP::setBufferBytesAt(uint16_t offset, const void *buff, uint1
     memcpy(&m_buff[c_HiLevBuffOffset+offset], buff, count);
 }
 
+uint8_t* ModbusSlaveIOTCP::bufferData(uint16_t offset)
+{
+    return &m_buff[c_HiLevBuffOffset+offset];
+}
+
 Modbus::Response ModbusSlaveIOTCP::begin()
 {
     uint8_t sock, s;
@@ -47,6 +47,7 @@ protected: // buffer control interface
     virtual void getBufferBytesAt(uint16_t offset, void *buff, uint16_t count) const;
     virtual void setBufferByteAt(uint16_t offset, uint8_t value);
     virtual void setBufferBytesAt(uint16_t offset, const void *buff, uint16_t count);
+    virtual uint8_t* bufferData(uint16_t offset);
 
 protected: // IO interface
     virtual Modbus::Response begin();
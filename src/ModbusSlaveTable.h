@@ -0,0 +1,113 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSSLAVETABLE_H
+#define MODBUSSLAVETABLE_H
+
+#include "Modbus.h"
+
+#define MODBUS_SLAVE_TABLE_TEMPLATE template <class Entry, uint8_t N>
+#define MODBUS_SLAVE_TABLE ModbusSlaveTable<Entry, N>
+
+// --------------------------------------------------------------------------------------------------------
+// --------------------------------------------- MODBUS SLAVE TABLE ---------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusSlaveTable is fixed size table of N per-slave entries found by slave address (unit id).
+    'Entry' is plain struct with 'uint8_t slave' and 'unsigned long last' fields,
+    'last' is time (millis) of last use of entry and 0 means that entry is free.
+    'get' takes entry of new slave from free ones or from least recently used slave,
+    'isSpare' (if set) chooses entries that are taken before others.
+*/
+MODBUS_SLAVE_TABLE_TEMPLATE
+class ModbusSlaveTable
+{
+public:
+    typedef bool (*IsSpare)(const Entry &e);
+
+public:
+    ModbusSlaveTable() { clear(); }
+
+public:
+    void clear();
+    const Entry* find(uint8_t slave) const;
+    inline Entry* find(uint8_t slave) { return const_cast<Entry*>(static_cast<const ModbusSlaveTable*>(this)->find(slave)); }
+    Entry* get(uint8_t slave, unsigned long now, IsSpare isSpare = MB_NULLPTR);
+    inline static void touch(Entry* e, unsigned long now) { e->last = now | 1; } // non zero value means that entry is used
+
+private:
+    Entry m_entries[N];
+};
+
+MODBUS_SLAVE_TABLE_TEMPLATE
+void MODBUS_SLAVE_TABLE::clear()
+{
+    for (uint8_t i = 0; i < N; i++)
+        m_entries[i] = Entry();
+}
+
+MODBUS_SLAVE_TABLE_TEMPLATE
+const Entry* MODBUS_SLAVE_TABLE::find(uint8_t slave) const
+{
+    for (uint8_t i = 0; i < N; i++)
+    {
+        if (m_entries[i].last && (m_entries[i].slave == slave))
+            return &m_entries[i];
+    }
+    return MB_NULLPTR;
+}
+
+MODBUS_SLAVE_TABLE_TEMPLATE
+Entry* MODBUS_SLAVE_TABLE::get(uint8_t slave, unsigned long now, IsSpare isSpare)
+{
+    Entry* e = find(slave);
+    Entry* c;
+    uint8_t i;
+
+    if (!e)
+    {
+        // take free entry or forget least recently used slave (spare one if it's possible)
+        for (i = 0; i < N; i++)
+        {
+            c = &m_entries[i];
+            if (!c->last)
+            {
+                e = c;
+                break;
+            }
+            if (!e)
+                e = c;
+            else if (isSpare && (isSpare(*c) != isSpare(*e)))
+                e = isSpare(*c) ? c : e;
+            else if (now-c->last > now-e->last) // elapsed time is right when millis() overflows
+                e = c;
+        }
+        *e = Entry();
+        e->slave = slave;
+    }
+    touch(e, now);
+    return e;
+}
+
+#endif // MODBUSSLAVETABLE_H
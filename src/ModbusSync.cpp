@@ -0,0 +1,222 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusSync.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ MODBUS SYNC -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+// maximum count of values in one frame
+static const uint16_t c_MaxFrameRegs = (MODBUS_SYNC_FRAME_REGS < MB_MAX_WRITE_REGISTERS) ? MODBUS_SYNC_FRAME_REGS : MB_MAX_WRITE_REGISTERS;
+static const uint16_t c_MaxFrameBits = (MODBUS_SYNC_FRAME_REGS*16 < MB_MAX_WRITE_DISCRETS) ? MODBUS_SYNC_FRAME_REGS*16 : MB_MAX_WRITE_DISCRETS;
+
+ModbusSyncBase::ModbusSyncBase(ModbusMaster* master, uint8_t slave, const uint8_t* source0x, uint8_t* shadow0x, uint16_t count0x, const uint16_t* source4x, uint16_t* shadow4x, uint16_t count4x)
+{
+    m_master = master;
+    m_slave = slave;
+    m_source0x = source0x;
+    m_shadow0x = shadow0x;
+    m_count0x = source0x ? count0x : 0;
+    m_source4x = source4x;
+    m_shadow4x = shadow4x;
+    m_count4x = source4x ? count4x : 0;
+    m_offset0x = 0;
+    m_offset4x = 0;
+    m_overhead = MODBUS_SYNC_FRAME_OVERHEAD;
+    m_table = 0;
+    m_cursor = 0;
+    m_frameCount = 0;
+    resetStatistics();
+    invalidate();
+}
+
+void ModbusSyncBase::resetStatistics()
+{
+    m_frames = 0;
+    m_values = 0;
+    m_errors = 0;
+    m_status = Modbus::OK;
+}
+
+// Makes every value dirty: shadow gets inverted values of source
+void ModbusSyncBase::invalidate()
+{
+    uint16_t i;
+
+    for (i = 0; i < (m_count0x+7)/8; i++)
+        m_shadow0x[i] = ~m_source0x[i];
+    for (i = 0; i < m_count4x; i++)
+        m_shadow4x[i] = ~m_source4x[i];
+}
+
+bool ModbusSyncBase::isDirty() const
+{
+    return m_frameCount || (findDirty(0, 0) >= 0) || (findDirty(4, 0) >= 0);
+}
+
+Modbus::Response ModbusSyncBase::exec()
+{
+    Modbus::Response r;
+    uint16_t fact = 0, i;
+    uint8_t slave;
+
+    if (!m_frameCount && !nextFrame()) // everything is synchronized
+        return Modbus::OK;
+    slave = m_slave;
+    if (m_frameTable == 4)
+    {
+        if (m_frameCount == 1)
+            r = m_master->forceSingleRegister(slave, m_offset4x+m_frameFirst, m_frame.regs[0]);
+        else
+            r = m_master->forceMultipleRegisters(slave, m_offset4x+m_frameFirst, m_frameCount, m_frame.regs, &fact);
+    }
+    else
+    {
+        if (m_frameCount == 1)
+            r = m_master->forceSingleCoil(slave, m_offset0x+m_frameFirst, Modbus::getBit(m_frame.bits, 0));
+        else
+            r = m_master->forceMultipleCoils(slave, m_offset0x+m_frameFirst, m_frameCount, m_frame.bits, &fact);
+    }
+    if (r == Modbus::PROCESSING)
+        return r;
+    if ((r == Modbus::OK) && ((m_frameCount == 1) || (fact == m_frameCount))) // acknowledged: slave has values of frame
+    {
+        if (m_frameTable == 4)
+            memcpy(&m_shadow4x[m_frameFirst], m_frame.regs, m_frameCount*sizeof(uint16_t));
+        else
+        {
+            for (i = 0; i < m_frameCount; i++)
+                Modbus::setBit(m_shadow0x, m_frameFirst+i, Modbus::getBit(m_frame.bits, i));
+        }
+    }
+    else
+    {
+        if (r == Modbus::OK)
+            r = Modbus::CMN_ERR_NOT_CORRECT;
+        m_errors++;
+    }
+    m_frames++;
+    m_values += m_frameCount;
+    m_frameCount = 0;
+    m_status = r;
+    return r;
+}
+
+bool ModbusSyncBase::isDirty0x(uint16_t i) const
+{
+    return Modbus::getBit(m_source0x, i) != Modbus::getBit(m_shadow0x, i);
+}
+
+bool ModbusSyncBase::isDirty4x(uint16_t i) const
+{
+    return m_source4x[i] != m_shadow4x[i];
+}
+
+// Returns index of first dirty value of 'table' started from 'from' or -1 if there is no such value
+int32_t ModbusSyncBase::findDirty(uint8_t table, uint16_t from) const
+{
+    uint16_t i;
+
+    if (table == 4)
+    {
+        for (i = from; i < m_count4x; i++)
+        {
+            if (m_source4x[i] != m_shadow4x[i])
+                return i;
+        }
+        return -1;
+    }
+    for (i = from; i < m_count0x; i++)
+    {
+        if (!(i & 7) && (m_source0x[i/8] == m_shadow0x[i/8])) // whole byte is clean
+        {
+            i += 7;
+            continue;
+        }
+        if (isDirty0x(i))
+            return i;
+    }
+    return -1;
+}
+
+// Finds next dirty values round robin from cursor and makes frame of them
+bool ModbusSyncBase::nextFrame()
+{
+    int32_t i;
+    uint8_t n, t = m_table;
+    uint16_t from = m_cursor;
+
+    for (n = 0; n < 3; n++) // current table from cursor, other table, current table from begin
+    {
+        i = findDirty(t, from);
+        if (i >= 0)
+        {
+            makeFrame(t, static_cast<uint16_t>(i));
+            return true;
+        }
+        t = (t == 4) ? 0 : 4;
+        from = 0;
+    }
+    return false;
+}
+
+// Frame begins from dirty value 'first' and ends on the last dirty value which clean gap before it costs
+// less than overhead of new frame
+void ModbusSyncBase::makeFrame(uint8_t table, uint16_t first)
+{
+    uint16_t count, maxCount, last, gap, i;
+
+    count = (table == 4) ? m_count4x : m_count0x;
+    maxCount = (table == 4) ? c_MaxFrameRegs : c_MaxFrameBits;
+    last = first;
+    gap = 0;
+    for (i = first+1; (i < count) && (i-first < maxCount); i++)
+    {
+        if ((table == 4) ? isDirty4x(i) : isDirty0x(i))
+        {
+            last = i;
+            gap = 0;
+        }
+        else
+        {
+            gap++;
+            if (((table == 4) ? gap*2 : (gap+7)/8) >= m_overhead) // new frame is cheaper than clean values
+                break;
+        }
+    }
+    m_frameTable = table;
+    m_frameFirst = first;
+    m_frameCount = last-first+1;
+    if (table == 4)
+        memcpy(m_frame.regs, &m_source4x[first], m_frameCount*sizeof(uint16_t));
+    else
+    {
+        for (i = 0; i < m_frameCount; i++)
+            Modbus::setBit(m_frame.bits, i, Modbus::getBit(m_source0x, first+i));
+    }
+    m_table = table;
+    m_cursor = last+1;
+}
@@ -0,0 +1,140 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSSYNC_H
+#define MODBUSSYNC_H
+
+#include "ModbusMaster.h"
+#include "ModbusMemory.h"
+
+// maximum count of registers in one frame of sync (bits: 16 times more), it's size of frame buffer
+#ifndef MODBUS_SYNC_FRAME_REGS
+#define MODBUS_SYNC_FRAME_REGS 64
+#endif
+
+// default cost of one frame in bytes that are not data: request and response headers with crc, silence between frames
+#ifndef MODBUS_SYNC_FRAME_OVERHEAD
+#define MODBUS_SYNC_FRAME_OVERHEAD 24
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ MODBUS SYNC -------------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusSyncBase pushes coils (0x) and holding registers (4x) of local image to remote slave through ModbusMaster
+    in non blocking mode (call 'exec' in loop). It keeps shadow copy of values acknowledged by slave, so only values
+    that differ from shadow (dirty) are written. Dirty values separated by clean ones are merged into one frame
+    while cost of clean values (2 bytes per register, 1 byte per 8 coils) is less than 'frameOverhead' bytes of
+    new frame (clean values are equal to slave's ones, so it's safe to write them again). Single value is written
+    by FC5/FC6, others by FC15/FC16. Shadow is updated with values of frame only when slave acknowledged it,
+    so failed frame is written again. Shadow is invalid at start (everything is dirty), call 'invalidate' when
+    slave state is unknown (e.g. slave was restarted).
+    Local value i is written to remote address 'offset0x'+i / 'offset4x'+i.
+*/
+class ModbusSyncBase
+{
+public:
+    ModbusSyncBase(ModbusMaster* master, uint8_t slave, const uint8_t* source0x, uint8_t* shadow0x, uint16_t count0x, const uint16_t* source4x, uint16_t* shadow4x, uint16_t count4x);
+
+public:
+    inline ModbusMaster* master() const { return m_master; }
+    inline uint8_t slave() const { return m_slave; }
+    inline void setSlave(uint8_t slave) { m_slave = slave; }
+    inline uint16_t offset0x() const { return m_offset0x; }
+    inline void setOffset0x(uint16_t offset) { m_offset0x = offset; }
+    inline uint16_t offset4x() const { return m_offset4x; }
+    inline void setOffset4x(uint16_t offset) { m_offset4x = offset; }
+    inline uint16_t frameOverhead() const { return m_overhead; }
+    inline void setFrameOverhead(uint16_t bytes) { m_overhead = bytes; }
+
+public: // statistics
+    inline uint32_t frames() const { return m_frames; } // count of frames that was sent
+    inline uint32_t values() const { return m_values; } // count of values (dirty and merged clean) that was sent
+    inline uint32_t errors() const { return m_errors; } // count of frames that was not acknowledged
+    inline Modbus::Response status() const { return m_status; } // result of last frame
+    void resetStatistics();
+
+public:
+    void invalidate();
+    bool isDirty() const;
+    Modbus::Response exec();
+
+private:
+    bool isDirty0x(uint16_t i) const;
+    bool isDirty4x(uint16_t i) const;
+    int32_t findDirty(uint8_t table, uint16_t from) const;
+    bool nextFrame();
+    void makeFrame(uint8_t table, uint16_t first);
+
+private:
+    ModbusMaster* m_master;
+    uint8_t m_slave;
+    const uint8_t* m_source0x;
+    uint8_t* m_shadow0x;
+    uint16_t m_count0x;
+    const uint16_t* m_source4x;
+    uint16_t* m_shadow4x;
+    uint16_t m_count4x;
+    uint16_t m_offset0x;
+    uint16_t m_offset4x;
+    uint16_t m_overhead;
+    uint8_t m_table;            // table where next frame is searched from (0 or 4)
+    uint16_t m_cursor;          // value where next frame is searched from
+    // frame in process
+    uint8_t m_frameTable;
+    uint16_t m_frameFirst;
+    uint16_t m_frameCount;      // 0 - there is no frame in process
+    union
+    {
+        uint16_t regs[MODBUS_SYNC_FRAME_REGS];
+        uint8_t bits[MODBUS_SYNC_FRAME_REGS*2];
+    } m_frame;
+    // statistics
+    uint32_t m_frames;
+    uint32_t m_values;
+    uint32_t m_errors;
+    Modbus::Response m_status;
+};
+
+/*
+    ModbusSyncT keeps shadow copy for coils and holding registers of ModbusMemoryT<N0x, N1x, N3x, N4x>
+    (input tables are not synchronized), e.g. `ModbusSyncT<16, 0, 0, 100> sync(&master, 1, &image);`.
+    ModbusSync is ModbusSyncT for ModbusMemory.
+*/
+MODBUS_MEMORY_T_TEMPLATE
+class ModbusSyncT : private ModbusMemoryTable<0, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N0x)>,
+                    private ModbusMemoryTable<4, uint16_t, N4x>,
+                    public ModbusSyncBase
+{
+    typedef ModbusMemoryTable<0, uint8_t , MODBUS_MEMORY_BITS_SZ_BYTES(N0x)> Shadow0x;
+    typedef ModbusMemoryTable<4, uint16_t, N4x> Shadow4x;
+
+public:
+    ModbusSyncT(ModbusMaster* master, uint8_t slave, const MODBUS_MEMORY_T* memory) :
+        ModbusSyncBase(master, slave, memory->mem0x(), Shadow0x::data(), N0x, memory->mem4x(), Shadow4x::data(), N4x) {}
+};
+
+typedef ModbusSyncT<MODBUS_MEMORY_COUNT_0x, MODBUS_MEMORY_COUNT_1x, MODBUS_MEMORY_COUNT_3x, MODBUS_MEMORY_COUNT_4x> ModbusSync;
+
+#endif // MODBUSSYNC_H
@@ -0,0 +1,213 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#include "ModbusWriteBuffer.h"
+
+#include <Arduino.h>
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------- MODBUS WRITE BUFFER ----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+ModbusWriteBuffer::ModbusWriteBuffer(ModbusMaster* master)
+{
+    m_master = master;
+    m_flushSize = MODBUS_WRITE_BUFFER_FLUSH_SZ;
+    m_flushDelay = MODBUS_WRITE_BUFFER_FLUSH_DELAY;
+    m_retries = MODBUS_WRITE_BUFFER_RETRIES;
+    m_count = 0;
+    m_first = 0;
+    m_flushing = false;
+    m_frameCount = 0;
+    resetStatistics();
+}
+
+void ModbusWriteBuffer::resetStatistics()
+{
+    m_writes = 0;
+    m_overwrites = 0;
+    m_frames = 0;
+    m_errors = 0;
+    m_dropped = 0;
+    m_status = Modbus::OK;
+}
+
+// Returns false if buffer is full (flush is started then, call 'exec' until there is free place)
+bool ModbusWriteBuffer::writeRegister(uint8_t slave, uint16_t offset, uint16_t value)
+{
+    return write(slave, MBF_FORCE_SINGLE_REGISTER, offset, value);
+}
+
+bool ModbusWriteBuffer::writeCoil(uint8_t slave, uint16_t offset, bool value)
+{
+    return write(slave, MBF_FORCE_SINGLE_COIL, offset, value);
+}
+
+bool ModbusWriteBuffer::write(uint8_t slave, uint8_t func, uint16_t offset, uint16_t value)
+{
+    int i = find(slave, func, offset);
+
+    if (i >= 0) // last writer wins
+    {
+        m_entries[i].value = value;
+        m_entries[i].tries = 0;
+        m_entries[i].sent = false; // new value is written by next frame
+        m_writes++;
+        m_overwrites++;
+        return true;
+    }
+    if (m_count >= MODBUS_WRITE_BUFFER_SZ)
+    {
+        m_flushing = true;
+        return false;
+    }
+    if (!m_count)
+        m_first = millis();
+    m_entries[m_count].slave = slave;
+    m_entries[m_count].func = func;
+    m_entries[m_count].offset = offset;
+    m_entries[m_count].value = value;
+    m_entries[m_count].tries = 0;
+    m_entries[m_count].sent = false;
+    m_count++;
+    m_writes++;
+    return true;
+}
+
+Modbus::Response ModbusWriteBuffer::exec()
+{
+    Modbus::Response r;
+    uint8_t slave;
+
+    if (!m_frameCount) // there is no frame in process: check if flush must be started
+    {
+        if (!m_count)
+        {
+            m_flushing = false;
+            return Modbus::OK;
+        }
+        if (!m_flushing && (m_count < m_flushSize) && (millis()-m_first < m_flushDelay))
+            return Modbus::OK;
+        m_flushing = true;
+        prepareFrame();
+    }
+    slave = m_frameSlave;
+    if (m_frameFunc == MBF_FORCE_SINGLE_REGISTER)
+    {
+        if (m_frameCount == 1)
+            r = m_master->forceSingleRegister(slave, m_frameOffset, m_frame[0]);
+        else
+            r = m_master->forceMultipleRegisters(slave, m_frameOffset, m_frameCount, m_frame);
+    }
+    else
+    {
+        if (m_frameCount == 1)
+            r = m_master->forceSingleCoil(slave, m_frameOffset, Modbus::getBit(m_frame, 0));
+        else
+            r = m_master->forceMultipleCoils(slave, m_frameOffset, m_frameCount, m_frame);
+    }
+    if (r == Modbus::PROCESSING)
+        return r;
+    m_frameCount = 0;
+    m_frames++;
+    if (r != Modbus::OK)
+        m_errors++;
+    m_status = r;
+    completeFrame(r);
+    if (!m_count)
+        m_flushing = false;
+    return r;
+}
+
+int ModbusWriteBuffer::find(uint8_t slave, uint8_t func, uint16_t offset) const
+{
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        if ((m_entries[i].offset == offset) && (m_entries[i].slave == slave) && (m_entries[i].func == func))
+            return i;
+    }
+    return -1;
+}
+
+// removes i-th pending write keeping order of others
+void ModbusWriteBuffer::take(uint8_t i)
+{
+    m_count--;
+    for (; i < m_count; i++)
+        m_entries[i] = m_entries[i+1];
+}
+
+// Copies run of adjacent addresses which contains the oldest pending write into frame
+void ModbusWriteBuffer::prepareFrame()
+{
+    uint16_t first, last;
+    int i;
+
+    m_frameSlave = m_entries[0].slave;
+    m_frameFunc = m_entries[0].func;
+    first = last = m_entries[0].offset;
+    while ((first > 0) && (last-first+1 < MODBUS_WRITE_BUFFER_SZ) && (find(m_frameSlave, m_frameFunc, first-1) >= 0))
+        first--;
+    while ((last < 0xFFFF) && (last-first+1 < MODBUS_WRITE_BUFFER_SZ) && (find(m_frameSlave, m_frameFunc, last+1) >= 0))
+        last++;
+    m_frameOffset = first;
+    m_frameCount = static_cast<uint8_t>(last-first+1);
+    for (uint16_t a = first; ; a++)
+    {
+        i = find(m_frameSlave, m_frameFunc, a);
+        if (m_frameFunc == MBF_FORCE_SINGLE_REGISTER)
+            m_frame[a-first] = m_entries[i].value;
+        else
+            Modbus::setBit(m_frame, a-first, m_entries[i].value != 0);
+        m_entries[i].sent = true;
+        if (a == last)
+            break;
+    }
+}
+
+// Removes writes of acknowledged frame, failed writes stay pending until they are repeated 'retries' times
+void ModbusWriteBuffer::completeFrame(Modbus::Response r)
+{
+    Entry* e;
+    uint8_t i = 0;
+
+    while (i < m_count)
+    {
+        e = &m_entries[i];
+        if (!e->sent) // not in frame or was overwritten while frame was in process
+        {
+            i++;
+            continue;
+        }
+        e->sent = false;
+        if (r == Modbus::OK)
+            take(i);
+        else if (e->tries++ >= m_retries)
+        {
+            m_dropped++;
+            take(i);
+        }
+        else
+            i++;
+    }
+}
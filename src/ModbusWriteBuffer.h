@@ -0,0 +1,140 @@
+/*
+    Modbus library for Arduino
+    
+    Created: 10/2019    
+    Author: Serhii Marchuk <marchserh@gmail.com>
+    
+    Copyright (C) 2019  Serhii Marchuk
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    
+*/
+
+#ifndef MODBUSWRITEBUFFER_H
+#define MODBUSWRITEBUFFER_H
+
+#include "ModbusMaster.h"
+
+// count of single writes that can be pending in ModbusWriteBuffer (it's maximum size of one frame too)
+#ifndef MODBUS_WRITE_BUFFER_SZ
+#define MODBUS_WRITE_BUFFER_SZ 32
+#endif
+
+// default count of pending writes that starts flush
+#ifndef MODBUS_WRITE_BUFFER_FLUSH_SZ
+#define MODBUS_WRITE_BUFFER_FLUSH_SZ (MODBUS_WRITE_BUFFER_SZ/2)
+#endif
+
+// default time (milliseconds) that first pending write waits for others before flush
+#ifndef MODBUS_WRITE_BUFFER_FLUSH_DELAY
+#define MODBUS_WRITE_BUFFER_FLUSH_DELAY 20
+#endif
+
+// default count of repeats of failed write before it's dropped
+#ifndef MODBUS_WRITE_BUFFER_RETRIES
+#define MODBUS_WRITE_BUFFER_RETRIES 3
+#endif
+
+// --------------------------------------------------------------------------------------------------------
+// ------------------------------------------- MODBUS WRITE BUFFER ----------------------------------------
+// --------------------------------------------------------------------------------------------------------
+
+/*
+    ModbusWriteBuffer collects single register/coil writes and sends them to any ModbusMaster in non blocking mode
+    (call 'exec' in loop). Pending writes of the same slave and type with adjacent addresses are merged into one
+    forceMultipleRegisters/forceMultipleCoils frame (single value is sent by forceSingleRegister/forceSingleCoil),
+    later write to pending address replaces its value (last writer wins). Addresses with gaps between them are not
+    merged: values of gap are unknown and must not be written.
+    Flush begins when 'flushSize' writes are pending, 'flushDelay' is elapsed since first pending write,
+    buffer is full or 'flush' is called, and lasts until buffer is empty. Writes order between different
+    addresses is not kept.
+    Writes of frame stay pending until slave acknowledges it: failed frame (timeout, exception, CRC error etc)
+    is repeated up to 'retries' times, then its writes are dropped and counted in 'dropped'. Write to address
+    of frame in process replaces its value and isn't removed by acknowledge of old value.
+*/
+class ModbusWriteBuffer
+{
+public:
+    ModbusWriteBuffer(ModbusMaster* master);
+
+public:
+    inline ModbusMaster* master() const { return m_master; }
+    inline uint8_t flushSize() const { return m_flushSize; }
+    inline void setFlushSize(uint8_t size) { m_flushSize = size; }
+    inline unsigned long flushDelay() const { return m_flushDelay; }
+    inline void setFlushDelay(unsigned long delay) { m_flushDelay = delay; }
+    inline uint8_t retries() const { return m_retries; }
+    inline void setRetries(uint8_t retries) { m_retries = retries; }
+    inline uint8_t pending() const { return m_count; }
+    inline bool isFlushing() const { return m_flushing || m_frameCount; }
+
+public: // statistics
+    inline uint32_t writes() const { return m_writes; } // count of accepted single writes
+    inline uint32_t overwrites() const { return m_overwrites; } // count of writes that replaced pending value
+    inline uint32_t frames() const { return m_frames; } // count of frames that was sent
+    inline uint32_t saved() const { return m_writes - m_frames; } // count of frames saved by coalescing
+    inline uint32_t errors() const { return m_errors; } // count of frames that was not written
+    inline uint32_t dropped() const { return m_dropped; } // count of writes dropped after 'retries' failed repeats
+    inline Modbus::Response status() const { return m_status; } // result of last frame
+    void resetStatistics();
+
+public:
+    bool writeRegister(uint8_t slave, uint16_t offset, uint16_t value);
+    bool writeCoil(uint8_t slave, uint16_t offset, bool value);
+    inline void flush() { if (m_count) m_flushing = true; }
+    Modbus::Response exec();
+
+private:
+    struct Entry
+    {
+        uint8_t slave;
+        uint8_t func;       // MBF_FORCE_SINGLE_REGISTER or MBF_FORCE_SINGLE_COIL
+        uint16_t offset;
+        uint16_t value;
+        uint8_t tries;      // count of failed frames with this value
+        bool sent;          // value is in frame in process
+    };
+
+private:
+    bool write(uint8_t slave, uint8_t func, uint16_t offset, uint16_t value);
+    int find(uint8_t slave, uint8_t func, uint16_t offset) const;
+    void take(uint8_t i);
+    void prepareFrame();
+    void completeFrame(Modbus::Response r);
+
+private:
+    ModbusMaster* m_master;
+    uint8_t m_flushSize;
+    unsigned long m_flushDelay;
+    uint8_t m_retries;
+    Entry m_entries[MODBUS_WRITE_BUFFER_SZ];
+    uint8_t m_count;
+    unsigned long m_first;      // time of first pending write
+    bool m_flushing;
+    // frame in process
+    uint8_t m_frameSlave;
+    uint8_t m_frameFunc;
+    uint16_t m_frameOffset;
+    uint8_t m_frameCount;       // 0 - there is no frame in process
+    uint16_t m_frame[MODBUS_WRITE_BUFFER_SZ];
+    // statistics
+    uint32_t m_writes;
+    uint32_t m_overwrites;
+    uint32_t m_frames;
+    uint32_t m_errors;
+    uint32_t m_dropped;
+    Modbus::Response m_status;
+};
+
+#endif // MODBUSWRITEBUFFER_H